@@ -0,0 +1,187 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Analyzes a file of positions, one per line in the form parsePosition reads
+ * (64 squares of X/O/- then the side to move), with a pool of worker threads
+ * that share one transposition table. Each position is searched to a fixed
+ * depth or for a fixed time, and one result line per position is written in
+ * input order as soon as every earlier position is done:
+ *
+ *   <position> move <move> score <score> depth <depth> nodes <nodes> pv <moves...>
+ *
+ * depth is replaced by "exact <empties>" when the position was solved to the
+ * end of the game, and by "proven <depth>" when the search found a result it
+ * can force within its depth. In both cases score is a final disc difference;
+ * otherwise it is in evaluator units.
+ */
+
+static EngineConfig config;
+static int msPerPosition = -1;
+static TranspositionTable *table = nullptr;
+static EndgameTable *endgameTable = nullptr;
+
+static vector<string> positions;
+static vector<string> results;
+static vector<bool> finished;
+static size_t written = 0;
+static atomic<size_t> nextPosition(0);
+static mutex outputLock;
+static ostream *output = &cout;
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-j threads] [-d depth] [-t msPerPosition] [-e endgameEmpties]"
+         << " [-c ttMB] [-o output] [positions]" << endl;
+    cerr << "positions are read from standard input if no file is given" << endl;
+    exit(-1);
+}
+
+static string squareName(int square) {
+    if (square < 0) return "pass";
+    return string(1, (char) ('a' + square % 8)) + (char) ('1' + square / 8);
+}
+
+/*
+ * Searches one position and formats its result line.
+ */
+static string analyze(const string &text) {
+    Board board;
+    Side side;
+    if (!parsePosition(text, &board, &side)) {
+        return text + " error bad position";
+    }
+
+    Player player(side);
+    player.testingMinimax = config.discEval;
+    player.setSearchDepth(config.depth);
+    player.setEndgameEmpties(config.endgameEmpties);
+    player.setInternalDeepening(config.iidDepth, config.iidReduction);
+    player.setEvaluators(config.leafEval, config.orderEval);
+    player.setTranspositionTable(table);
+    player.setEndgameTable(endgameTable);
+    player.setBoard(board.copy());
+
+    // Player spreads msLeft over the moves it still expects to make; ask for
+    // enough that this one move gets msPerPosition.
+    int msLeft = -1;
+    if (msPerPosition > 0) {
+        int empties = 64 - board.countBlack() - board.countWhite();
+        msLeft = msPerPosition * ((empties + 1) / 2 + 1);
+    }
+    Move *move = player.doMove(nullptr, msLeft);
+    const SearchStats &s = player.getLastStats();
+
+    stringstream line;
+    line << formatPosition(&board, side)
+         << " move " << (move == nullptr ? "pass" : squareName(move->getX() + 8 * move->getY()))
+         << " score " << s.score << (s.solved ? " exact " : s.proven ? " proven " : " depth ") << s.depth
+         << " nodes " << s.nodes << " pv";
+    for (size_t i = 0; i < s.pv.size(); i++) {
+        line << " " << squareName(s.pv[i]);
+    }
+    delete move;
+    return line.str();
+}
+
+/*
+ * Worker thread body; takes positions in input order until there are none
+ * left, and writes out every result that is next in line.
+ */
+static void worker() {
+    size_t p;
+    while ((p = nextPosition++) < positions.size()) {
+        string result = analyze(positions[p]);
+
+        lock_guard<mutex> guard(outputLock);
+        results[p] = result;
+        finished[p] = true;
+        while (written < positions.size() && finished[written]) {
+            *output << results[written] << "\n";
+            results[written].clear();
+            written++;
+        }
+        output->flush();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int threads = thread::hardware_concurrency();
+    config.ttMB = 64;
+    const char *outputFile = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:d:t:e:c:o:")) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'd':
+                config.depth = atoi(optarg);
+                if (config.depth < 1) usage(argv[0]);
+                break;
+            case 't': msPerPosition = atoi(optarg); break;
+            case 'e': config.endgameEmpties = atoi(optarg); break;
+            case 'c': config.ttMB = strtoul(optarg, nullptr, 10); break;
+            case 'o': outputFile = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind < argc - 1) usage(argv[0]);
+    if (threads < 1) threads = 1;
+
+    ifstream file;
+    istream *in = &cin;
+    if (optind == argc - 1) {
+        file.open(argv[optind]);
+        if (!file) {
+            cerr << "analyze: cannot read " << argv[optind] << endl;
+            exit(-1);
+        }
+        in = &file;
+    }
+    string line;
+    while (getline(*in, line)) {
+        if (!line.empty() && line[0] != '#') positions.push_back(line);
+    }
+
+    ofstream out;
+    if (outputFile != nullptr) {
+        out.open(outputFile);
+        if (!out) {
+            cerr << "analyze: cannot write " << outputFile << endl;
+            exit(-1);
+        }
+        output = &out;
+    }
+
+    if (config.ttMB > 0) {
+        table = new TranspositionTable(config.ttMB << 20);
+        endgameTable = new EndgameTable(ENDGAME_TT_BYTES);
+    }
+    results.resize(positions.size());
+    finished.assign(positions.size(), false);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread(worker));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "analyzed " << positions.size() << " positions in " << seconds << " s on "
+         << threads << " threads" << endl;
+
+    delete table;
+    delete endgameTable;
+    return 0;
+}
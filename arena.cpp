@@ -0,0 +1,33 @@
+#include "arena.hpp"
+#include "memory.hpp"
+#include <algorithm>
+
+/*
+ * Reserves the arena's whole block. This is the only time an arena uses the
+ * global allocator. A search cannot run without its arena, so the block is
+ * charged to the process memory budget rather than reserved from it.
+ */
+Arena::Arena(size_t bytes) {
+    block = static_cast<char *>(::operator new(bytes));
+    MemoryBudget::process().charge("arena", bytes);
+    capacity = bytes;
+    used = 0;
+    peak = 0;
+}
+
+Arena::~Arena() {
+    ::operator delete(block);
+    MemoryBudget::process().release("arena", capacity);
+}
+
+/*
+ * Returns bytes of uninitialized memory at the given alignment (a power of
+ * two), or nullptr if the arena is full.
+ */
+void *Arena::allocate(size_t bytes, size_t alignment) {
+    size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (start > capacity || bytes > capacity - start) return nullptr;
+    used = start + bytes;
+    peak = std::max(peak, used);
+    return block + start;
+}
@@ -0,0 +1,48 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <cstddef>
+#include <new>
+
+/*
+ * A bump-pointer allocator over one block reserved up front. Allocation moves
+ * a pointer; memory is handed back only in bulk, by releasing everything
+ * allocated after a mark. Destructors are never run, so only objects that do
+ * not own other memory belong here. An arena is not thread safe; each search
+ * thread has its own.
+ */
+class Arena {
+
+public:
+    Arena(size_t bytes);
+    ~Arena();
+
+    void *allocate(size_t bytes, size_t alignment);
+    template <typename T> T *create(size_t count);
+
+    size_t mark() { return used; }
+    void release(size_t mark) { used = mark; }
+    size_t getUsed() { return used; }
+    size_t getPeak() { return peak; }
+    size_t getCapacity() { return capacity; }
+
+private:
+    char *block;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+};
+
+/*
+ * Allocates and default-constructs count objects of type T. Returns nullptr
+ * if the arena is full.
+ */
+template <typename T> T *Arena::create(size_t count) {
+    T *objects = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    for (size_t i = 0; objects != nullptr && i < count; i++) {
+        new (objects + i) T();
+    }
+    return objects;
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Microbenchmarks for the Board and Player hot paths. Each operation is run
+ * over every position of a group as one batch; a batch is timed as a whole
+ * and divided by the number of calls it made. After warm-up batches, the
+ * median and 99th percentile of the per-call times over the timed batches are
+ * reported, either as a table or as one JSON object per line for diffing
+ * between commits.
+ */
+
+struct BenchPosition {
+    Board board;
+    Side side;
+    vector<Move> moves;
+};
+
+struct BenchResult {
+    string op, group;
+    long long calls;
+    double medianNs, p99Ns;
+};
+
+static int warmups = 3;
+static int runs = 25;
+static int searchDepth = 4;
+static volatile long long sink;
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-f positions] [-r runs] [-w warmups]"
+         << " [-d searchDepth] [-o text|json] [ops...]" << endl;
+    cerr << "ops: checkMove hasMoves getMoves doMove getScore copy negamax" << endl;
+    exit(-1);
+}
+
+/*
+ * Times one operation over a group. body runs the whole batch and returns the
+ * number of calls it made.
+ */
+static BenchResult measure(const string &op, const string &group,
+        const function<long long()> &body) {
+    long long calls = 0;
+    for (int i = 0; i < warmups; i++) {
+        calls = body();
+    }
+    vector<double> samples;
+    for (int i = 0; i < runs; i++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        calls = body();
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        samples.push_back(ns / max(calls, 1LL));
+    }
+    sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.op = op;
+    result.group = group;
+    result.calls = calls;
+    result.medianNs = samples[samples.size() / 2];
+    result.p99Ns = samples[min(samples.size() - 1, (size_t) (samples.size() * 0.99))];
+    return result;
+}
+
+static vector<BenchResult> runGroup(const string &group, vector<BenchPosition> &positions,
+        const vector<string> &ops) {
+    vector<BenchResult> results;
+    vector<Player*> players;
+    for (size_t o = 0; o < ops.size(); o++) {
+        const string &op = ops[o];
+        function<long long()> body;
+        if (op == "checkMove") {
+            body = [&]() {
+                long long calls = 0, found = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    for (int i = 0; i < 64; i++) {
+                        Move move(i % 8, i / 8);
+                        found += positions[p].board.checkMove(&move, positions[p].side);
+                        calls++;
+                    }
+                }
+                sink = found;
+                return calls;
+            };
+        } else if (op == "hasMoves") {
+            body = [&]() {
+                long long found = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    found += positions[p].board.hasMoves(BLACK);
+                    found += positions[p].board.hasMoves(WHITE);
+                }
+                sink = found;
+                return (long long) positions.size() * 2;
+            };
+        } else if (op == "getMoves") {
+            body = [&]() {
+                long long found = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    MoveList moves = positions[p].board.getMoves(positions[p].side);
+                    found += moves.count;
+                }
+                sink = found;
+                return (long long) positions.size();
+            };
+        } else if (op == "doMove") {
+            body = [&]() {
+                long long calls = 0, discs = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    for (size_t m = 0; m < positions[p].moves.size(); m++) {
+                        Board child = positions[p].board;
+                        child.doMove(&positions[p].moves[m], positions[p].side);
+                        discs += child.countBlack();
+                        calls++;
+                    }
+                }
+                sink = discs;
+                return calls;
+            };
+        } else if (op == "getScore") {
+            body = [&]() {
+                long long total = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    total += positions[p].board.getScore(positions[p].side, false);
+                }
+                sink = total;
+                return (long long) positions.size();
+            };
+        } else if (op == "copy") {
+            body = [&]() {
+                long long discs = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    Board *copy = positions[p].board.copy();
+                    discs += copy->countWhite();
+                    delete copy;
+                }
+                sink = discs;
+                return (long long) positions.size();
+            };
+        } else if (op == "negamax") {
+            // One fixed-depth, full-window negamax per position, without
+            // iterative deepening or the endgame solver. The players are set
+            // up here so that building them is not timed, and have no table,
+            // so every run searches the same tree.
+            for (size_t p = 0; p < positions.size(); p++) {
+                Player *player = new Player(positions[p].side);
+                player->setBoard(positions[p].board.copy());
+                player->setEndgameEmpties(0);
+                players.push_back(player);
+            }
+            body = [&]() {
+                long long total = 0;
+                for (size_t p = 0; p < positions.size(); p++) {
+                    pair<int, Move*> result = players[p]->negamax(&positions[p].board,
+                        positions[p].side, searchDepth, INT_MIN + 1, INT_MAX);
+                    total += result.first;
+                    delete result.second;
+                }
+                sink = total;
+                return (long long) positions.size();
+            };
+        } else {
+            cerr << "bench: unknown op " << op << endl;
+            usage("bench");
+        }
+        results.push_back(measure(op, group, body));
+    }
+    for (size_t p = 0; p < players.size(); p++) {
+        delete players[p];
+    }
+    return results;
+}
+
+int main(int argc, char *argv[]) {
+    const char *positionFile = "benchpositions.txt";
+    bool json = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:w:d:o:")) != -1) {
+        switch (opt) {
+            case 'f': positionFile = optarg; break;
+            case 'r': runs = atoi(optarg); break;
+            case 'w': warmups = atoi(optarg); break;
+            case 'd': searchDepth = atoi(optarg); break;
+            case 'o':
+                if (string(optarg) != "text" && string(optarg) != "json") usage(argv[0]);
+                json = (string(optarg) == "json");
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (runs < 1 || warmups < 0 || searchDepth < 1) usage(argv[0]);
+
+    vector<string> ops;
+    for (int i = optind; i < argc; i++) {
+        ops.push_back(argv[i]);
+    }
+    if (ops.empty()) {
+        const char *all[] = { "checkMove", "hasMoves", "getMoves", "doMove", "getScore", "copy",
+            "negamax" };
+        ops.assign(all, all + 7);
+    }
+
+    // Lines are "<position> <group>"; groups are benchmarked separately, in
+    // the order they first appear.
+    ifstream in(positionFile);
+    if (!in) {
+        cerr << "bench: cannot read " << positionFile << endl;
+        exit(-1);
+    }
+    vector<string> groupOrder;
+    map<string, vector<BenchPosition> > groups;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        BenchPosition pos;
+        string board, side, group;
+        stringstream fields(line);
+        fields >> board >> side >> group;
+        if (!parsePosition(board + side, &pos.board, &pos.side)) {
+            cerr << "bench: bad position: " << line << endl;
+            exit(-1);
+        }
+        if (group.empty()) group = "all";
+        MoveList legal = pos.board.getMoves(pos.side);
+        for (int k = 0; k < legal.count; k++) {
+            pos.moves.push_back(Move(legal.squares[k] % 8, legal.squares[k] / 8));
+        }
+        if (groups.find(group) == groups.end()) groupOrder.push_back(group);
+        groups[group].push_back(pos);
+    }
+
+    cout << fixed << setprecision(1);
+    if (!json) {
+        cout << "op          group        calls/run     median ns        p99 ns" << endl;
+    }
+    for (size_t g = 0; g < groupOrder.size(); g++) {
+        vector<BenchResult> results = runGroup(groupOrder[g], groups[groupOrder[g]], ops);
+        for (size_t r = 0; r < results.size(); r++) {
+            BenchResult &b = results[r];
+            if (json) {
+                cout << "{\"op\":\"" << b.op << "\",\"group\":\"" << b.group
+                     << "\",\"calls\":" << b.calls << ",\"runs\":" << runs
+                     << ",\"median_ns\":" << b.medianNs << ",\"p99_ns\":" << b.p99Ns;
+                if (b.op == "negamax") cout << ",\"depth\":" << searchDepth;
+                cout << "}" << endl;
+            } else {
+                cout << left << setw(12) << b.op << setw(12) << b.group
+                     << right << setw(10) << b.calls << setw(14) << b.medianNs
+                     << setw(14) << b.p99Ns << endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -1,76 +1,181 @@
 #include "board.hpp"
+#include "tables.hpp"
 
 /*
- * Make a standard 8x8 othello board and initialize it to the standard setup.
+ * Make a standard othello board and initialize it to the standard setup.
  */
-Board::Board() {
-    taken.set(3 + 8 * 3);
-    taken.set(3 + 8 * 4);
-    taken.set(4 + 8 * 3);
-    taken.set(4 + 8 * 4);
-    black.set(4 + 8 * 3);
-    black.set(3 + 8 * 4);
+template <int N>
+BasicBoard<N>::BasicBoard() {
+    const int c = N / 2;
+    Bits one = 1;
+    black = (one << (c + N * (c - 1))) | (one << (c - 1 + N * c));
+    taken = black | (one << (c - 1 + N * (c - 1))) | (one << (c + N * c));
 }
 
 /*
  * Destructor for the board.
  */
-Board::~Board() {
+template <int N>
+BasicBoard<N>::~BasicBoard() {
 }
 
 /*
  * Returns a copy of this board.
  */
-Board *Board::copy() {
-    Board *newBoard = new Board();
+template <int N>
+BasicBoard<N> *BasicBoard<N>::copy() {
+    BasicBoard *newBoard = new BasicBoard();
     newBoard->black = black;
     newBoard->taken = taken;
     return newBoard;
 }
 
-bool Board::occupied(int x, int y) {
-    return taken[x + 8*y];
+template <int N>
+bool BasicBoard<N>::occupied(int x, int y) {
+    return (taken >> (x + N*y)) & 1;
 }
 
-bool Board::get(Side side, int x, int y) {
-    return occupied(x, y) && (black[x + 8*y] == (side == BLACK));
+/*
+ * Returns the discs of opp that a disc played by own on the given empty square
+ * would flip; none means the move is illegal. In each direction the nearest
+ * square that is not the opponent's ends the run of opponent discs, and the
+ * run is captured if that square is one of own's.
+ */
+template <int N>
+static BoardBits<N> flips(int square, BoardBits<N> own, BoardBits<N> opp) {
+    const BoardBits<N> one = 1;
+    BoardBits<N> flipped = 0;
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        BoardBits<N> ray = RAYS<N>.masks[square][direction];
+        BoardBits<N> stops = ray & ~opp;
+        if (stops == 0) continue;
+        int end = ascending(direction) ? lowestSquare(stops) : highestSquare(stops);
+        if ((own >> end) & 1) {
+            flipped |= ray & ~RAYS<N>.masks[end][direction] & ~(one << end);
+        }
+    }
+    return flipped;
 }
 
-void Board::set(Side side, int x, int y) {
-    taken.set(x + 8*y);
-    black.set(x + 8*y, side == BLACK);
+/*
+ * Moves every disc one step in direction D (see SHIFTS), dropping those that
+ * would leave the board.
+ */
+template <int N, int D>
+static inline BoardBits<N> shiftBits(BoardBits<N> bits) {
+    constexpr int amount = SHIFTS<N>.amounts[D];
+    return (amount > 0 ? bits << (amount > 0 ? amount : 0) : bits >> (amount < 0 ? -amount : 0))
+        & SHIFTS<N>.masks[D];
 }
 
-bool Board::onBoard(int x, int y) {
-    return(0 <= x && x < 8 && 0 <= y && y < 8);
+/*
+ * The empty squares from which own captures in direction D. The runs of opp
+ * discs that start next to one of own's are grown one step at a time, a run
+ * being at most N - 2 long; the empty square just past a run is a move.
+ */
+template <int N, int D>
+static inline BoardBits<N> movesInDirection(BoardBits<N> own, BoardBits<N> opp,
+        BoardBits<N> empty) {
+    BoardBits<N> run = shiftBits<N, D>(own) & opp;
+    for (int i = 0; i < N - 3; i++) {
+        run |= shiftBits<N, D>(run) & opp;
+    }
+    return shiftBits<N, D>(run) & empty;
 }
 
+/*
+ * movesInDirection for both sides at once. The two fills are independent, so
+ * interleaving them keeps the processor busy with one while the other waits.
+ */
+template <int N, int D>
+static inline void bothMovesInDirection(BoardBits<N> black, BoardBits<N> white,
+        BoardBits<N> empty, BoardBits<N> *blackMoves, BoardBits<N> *whiteMoves) {
+    BoardBits<N> blackRun = shiftBits<N, D>(black) & white;
+    BoardBits<N> whiteRun = shiftBits<N, D>(white) & black;
+    for (int i = 0; i < N - 3; i++) {
+        blackRun |= shiftBits<N, D>(blackRun) & white;
+        whiteRun |= shiftBits<N, D>(whiteRun) & black;
+    }
+    *blackMoves |= shiftBits<N, D>(blackRun) & empty;
+    *whiteMoves |= shiftBits<N, D>(whiteRun) & empty;
+}
 
 /*
  * Returns true if the game is finished; false otherwise. The game is finished
  * if neither side has a legal move.
  */
-bool Board::isDone() {
-    return !(hasMoves(BLACK) || hasMoves(WHITE));
+template <int N>
+bool BasicBoard<N>::isDone() {
+    Bits blackMoves, whiteMoves;
+    legalMoves(&blackMoves, &whiteMoves);
+    return blackMoves == 0 && whiteMoves == 0;
 }
 
 /*
  * Returns true if there are legal moves for the given side.
  */
-bool Board::hasMoves(Side side) {
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            Move move(i, j);
-            if (checkMove(&move, side)) return true;
-        }
+template <int N>
+bool BasicBoard<N>::hasMoves(Side side) {
+    return legalMoves(side) != 0;
+}
+
+/*
+ * Returns the mask of empty squares where the given side has a legal move.
+ */
+template <int N>
+typename BasicBoard<N>::Bits BasicBoard<N>::legalMoves(Side side) {
+    Side other = (side == BLACK) ? WHITE : BLACK;
+    Bits own = getBits(side);
+    Bits opp = getBits(other);
+    Bits empty = ~taken & SHIFTS<N>.board;
+    return movesInDirection<N, DIR_E>(own, opp, empty)
+        | movesInDirection<N, DIR_SW>(own, opp, empty)
+        | movesInDirection<N, DIR_S>(own, opp, empty)
+        | movesInDirection<N, DIR_SE>(own, opp, empty)
+        | movesInDirection<N, DIR_W>(own, opp, empty)
+        | movesInDirection<N, DIR_NE>(own, opp, empty)
+        | movesInDirection<N, DIR_N>(own, opp, empty)
+        | movesInDirection<N, DIR_NW>(own, opp, empty);
+}
+
+/*
+ * Computes the legal-move masks of both sides in one pass over the board.
+ */
+template <int N>
+void BasicBoard<N>::legalMoves(Bits *blackMoves, Bits *whiteMoves) {
+    Bits blackBits = getBits(BLACK);
+    Bits whiteBits = getBits(WHITE);
+    Bits empty = ~taken & SHIFTS<N>.board;
+    *blackMoves = 0;
+    *whiteMoves = 0;
+    bothMovesInDirection<N, DIR_E>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_SW>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_S>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_SE>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_W>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_NE>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_N>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+    bothMovesInDirection<N, DIR_NW>(blackBits, whiteBits, empty, blackMoves, whiteMoves);
+}
+
+/*
+ * Returns the legal moves of the given side as a list.
+ */
+template <int N>
+BasicMoveList<N> BasicBoard<N>::getMoves(Side side) {
+    BasicMoveList<N> list;
+    list.count = 0;
+    for (Bits legal = legalMoves(side); legal != 0; legal &= legal - 1) {
+        list.squares[list.count++] = lowestSquare(legal);
     }
-    return false;
+    return list;
 }
 
 /*
  * Returns true if a move is legal for the given side; false otherwise.
  */
-bool Board::checkMove(Move *m, Side side) {
+template <int N>
+bool BasicBoard<N>::checkMove(Move *m, Side side) {
     // Passing is only legal if you have no moves.
     if (m == nullptr) return !hasMoves(side);
 
@@ -81,85 +186,57 @@ bool Board::checkMove(Move *m, Side side) {
     if (occupied(X, Y)) return false;
 
     Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            // Is there a capture in that direction?
-            int x = X + dx;
-            int y = Y + dy;
-            if (onBoard(x, y) && get(other, x, y)) {
-                do {
-                    x += dx;
-                    y += dy;
-                } while (onBoard(x, y) && get(other, x, y));
-
-                if (onBoard(x, y) && get(side, x, y)) return true;
-            }
-        }
-    }
-    return false;
+    return flips<N>(X + N*Y, getBits(side), getBits(other)) != 0;
 }
 
 /*
  * Modifies the board to reflect the specified move.
  */
-void Board::doMove(Move *m, Side side) {
+template <int N>
+void BasicBoard<N>::doMove(Move *m, Side side) {
     // A nullptr move means pass.
     if (m == nullptr) return;
 
-    // Ignore if move is invalid.
-    if (!checkMove(m, side)) return;
-
     int X = m->getX();
     int Y = m->getY();
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
+    if (occupied(X, Y)) return;
 
-            int x = X;
-            int y = Y;
-            do {
-                x += dx;
-                y += dy;
-            } while (onBoard(x, y) && get(other, x, y));
+    // Ignore if move is invalid.
+    Side other = (side == BLACK) ? WHITE : BLACK;
+    Bits flipped = flips<N>(X + N*Y, getBits(side), getBits(other));
+    if (flipped == 0) return;
 
-            if (onBoard(x, y) && get(side, x, y)) {
-                x = X;
-                y = Y;
-                x += dx;
-                y += dy;
-                while (onBoard(x, y) && get(other, x, y)) {
-                    set(side, x, y);
-                    x += dx;
-                    y += dy;
-                }
-            }
-        }
+    Bits placed = flipped | ((Bits) 1 << (X + N*Y));
+    if (side == BLACK) {
+        black |= placed;
+    } else {
+        black &= ~flipped;
     }
-    set(side, X, Y);
+    taken |= placed;
 }
 
 /*
  * Current count of given side's stones.
  */
-int Board::count(Side side) {
+template <int N>
+int BasicBoard<N>::count(Side side) {
     return (side == BLACK) ? countBlack() : countWhite();
 }
 
 /*
  * Current count of black stones.
  */
-int Board::countBlack() {
-    return black.count();
+template <int N>
+int BasicBoard<N>::countBlack() {
+    return countSquares(black);
 }
 
 /*
  * Current count of white stones.
  */
-int Board::countWhite() {
-    return taken.count() - black.count();
+template <int N>
+int BasicBoard<N>::countWhite() {
+    return countSquares(taken) - countSquares(black);
 }
 
 /**
@@ -170,7 +247,8 @@ int Board::countWhite() {
  *
  * @return the score of this board for the provided side
  */
-int Board::getScore(Side side, bool testingMinimax) {
+template <int N>
+int BasicBoard<N>::getScore(Side side, bool testingMinimax) {
     int totalScore = 0;
     //simple scoring function for testing
     if (testingMinimax) {
@@ -180,40 +258,19 @@ int Board::getScore(Side side, bool testingMinimax) {
             totalScore = this->countWhite() - this->countBlack();
         }
     } else {
-        //weights for pieces in corresponding squares
-        const int CORNER_WEIGHT = 3;
-        const int EDGE_WEIGHT = 2;
-        const int NEXT_TO_CORNER_WEIGHT = -2;
-        const int DIAGONAL_TO_CORNER_WEIGHT = -3;
-        const int OTHER_WEIGHT = 1;
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                //score occupied squares only
-                if (this->occupied(i, j)) {
-                    //different positions are weighted differently
-                    Position pos = Board::getSquarePosition(i, j);
-                    int additionalScore = 0;
-                    if (pos == CORNER) {
-                        additionalScore = CORNER_WEIGHT;
-                    } else if (pos == DIAGONAL_TO_CORNER) {
-                        additionalScore = DIAGONAL_TO_CORNER_WEIGHT;
-                    } else if (pos == NEXT_TO_CORNER) {
-                        additionalScore = NEXT_TO_CORNER_WEIGHT;
-                    } else if (pos == EDGE) {
-                        additionalScore = EDGE_WEIGHT;
-                    } else if (pos == OTHER) {
-                        additionalScore = OTHER_WEIGHT;
-                    }
-                    //if piece is of opposite color, has opposite score
-                    if (!this->get(side, i, j)) {
-                        additionalScore = -additionalScore;
-                    }
-                    totalScore += additionalScore;
-                }
-            }
+        //weights for pieces in corresponding squares, indexed by Position
+        static const int WEIGHTS[OTHER + 1] = { 3, 2, -2, -3, 1 };
+        Bits own = this->getBits(side);
+        Bits opponent = this->getBits(side == BLACK ? WHITE : BLACK);
+        //each kind of square scores its weight per own piece and loses it
+        //per opponent piece
+        for (int pos = 0; pos <= OTHER; pos++) {
+            Bits squares = POSITIONS<N>.masks[pos];
+            totalScore += WEIGHTS[pos] * (countSquares(own & squares)
+                - countSquares(opponent & squares));
         }
     }
-    
+
     return totalScore;
 }
 
@@ -225,57 +282,50 @@ int Board::getScore(Side side, bool testingMinimax) {
  *
  * @return the position of the square at the provided coordinates
  */
-Position Board::getSquarePosition(int x, int y) {
-    Position pos;
-    bool isEdge = (x == 0) || (x == BOARD_SIZE - 1) || (y == 0) || (y == BOARD_SIZE - 1);
-    bool isCorner = 
-            (x == 0 && y == 0) || 
-            (x == 0 && y == BOARD_SIZE - 1) || 
-            (x == BOARD_SIZE - 1 && y == 0) || 
-            (x == BOARD_SIZE - 1 && y == BOARD_SIZE - 1);
-    bool isDiagonalToCorner = 
-            (x == 1 && y == 1) || 
-            (x == 1 && y == BOARD_SIZE - 2) || 
-            (x == BOARD_SIZE - 2 && y == 1) || 
-            (x == BOARD_SIZE - 2 && y == BOARD_SIZE - 2);
-    bool isNextToCorner = 
-            (x == 1 && y == 0) ||
-            (x == 0 && y == 1) ||
-            (x == 0 && y == BOARD_SIZE - 2) ||
-            (x == 1 && y == BOARD_SIZE - 1) ||
-            (x == BOARD_SIZE - 2 && y == BOARD_SIZE - 1) ||
-            (x == BOARD_SIZE - 1 && y == BOARD_SIZE - 2) ||
-            (x == BOARD_SIZE - 2 && y == 0) ||
-            (x == BOARD_SIZE - 1 && y == 1);
-    if (isCorner) {
-        pos = CORNER;
-    } else if (isDiagonalToCorner) {
-        pos = DIAGONAL_TO_CORNER;
-    } else if (isNextToCorner) {
-        pos = NEXT_TO_CORNER;
-    } else if (isEdge) {
-        pos = EDGE;
-    } else {
-        pos = OTHER;
+template <int N>
+Position BasicBoard<N>::getSquarePosition(int x, int y) {
+    return POSITIONS<N>.squares[x + N * y];
+}
+
+/*
+ * Returns the squares held by the given side as a bitboard, with square
+ * (x, y) at bit x + N*y.
+ */
+template <int N>
+typename BasicBoard<N>::Bits BasicBoard<N>::getBits(Side side) {
+    if (side == BLACK) {
+        return black;
     }
-    
-    return pos;
+    return taken & ~black;
 }
 
+/*
+ * Sets the board state from the bitboards of black and white squares, in
+ * the same layout getBits returns. The masks must not overlap.
+ */
+template <int N>
+void BasicBoard<N>::setBits(Bits blackBits, Bits whiteBits) {
+    black = blackBits;
+    taken = blackBits | whiteBits;
+}
 
 /*
- * Sets the board state given an 8x8 char array where 'w' indicates a white
+ * Sets the board state given an N*N char array where 'w' indicates a white
  * piece and 'b' indicates a black piece. Mainly for testing purposes.
  */
-void Board::setBoard(char data[]) {
-    taken.reset();
-    black.reset();
-    for (int i = 0; i < 64; i++) {
+template <int N>
+void BasicBoard<N>::setBoard(char data[]) {
+    taken = 0;
+    black = 0;
+    for (int i = 0; i < N * N; i++) {
         if (data[i] == 'b') {
-            taken.set(i);
-            black.set(i);
+            taken |= (Bits) 1 << i;
+            black |= (Bits) 1 << i;
         } if (data[i] == 'w') {
-            taken.set(i);
+            taken |= (Bits) 1 << i;
         }
     }
 }
+
+template class BasicBoard<8>;
+template class BasicBoard<10>;
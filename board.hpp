@@ -1,28 +1,94 @@
 #ifndef __BOARD_H__
 #define __BOARD_H__
 
-#include <bitset>
+#include <cstdint>
+#include <type_traits>
 #include "common.hpp"
 using namespace std;
 
-class Board {
+// Two machine words, for boards with more than 64 squares
+__extension__ typedef unsigned __int128 uint128_t;
+
+/*
+ * The bitboard type of an N x N board, with square (x, y) at bit x + N*y: a
+ * single 64-bit word whenever the squares fit in one, which is the fast path
+ * the engine plays on, and a two-word integer for boards up to 11x11.
+ */
+template <int N>
+using BoardBits = typename conditional<(N * N <= 64), uint64_t, uint128_t>::type;
+
+/*
+ * Bit scans and counts for both bitboard widths. The two-word versions look
+ * at the low word first.
+ */
+inline int lowestSquare(uint64_t bits) {
+    return __builtin_ctzll(bits);
+}
+
+inline int lowestSquare(uint128_t bits) {
+    uint64_t low = (uint64_t) bits;
+    return low != 0 ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t) (bits >> 64));
+}
+
+inline int highestSquare(uint64_t bits) {
+    return 63 - __builtin_clzll(bits);
+}
+
+inline int highestSquare(uint128_t bits) {
+    uint64_t high = (uint64_t) (bits >> 64);
+    return high != 0 ? 127 - __builtin_clzll(high) : 63 - __builtin_clzll((uint64_t) bits);
+}
+
+inline int countSquares(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+inline int countSquares(uint128_t bits) {
+    return __builtin_popcountll((uint64_t) bits) + __builtin_popcountll((uint64_t) (bits >> 64));
+}
+
+/*
+ * The legal moves of a position, as squares x + N*y. Filled from a legal-move
+ * mask, lowest square first, so it never holds anything but legal moves.
+ */
+template <int N>
+struct BasicMoveList {
+    int count;
+    uint8_t squares[N * N];
+};
+
+/*
+ * An N x N othello board, starting with the usual four discs in the centre.
+ * The engine plays on Board, 8x8 unless it is built with another BOARD_SIZE
+ * (qwerty10 is 10x10); larger sizes share the same move generator with
+ * two-word bitboards.
+ */
+template <int N>
+class BasicBoard {
+
+    static_assert(N >= 4 && N % 2 == 0 && N * N <= 128, "unsupported board size");
+
+public:
+    typedef BoardBits<N> Bits;
+    static const int SIZE = N;
+    static const int SQUARES = N * N;
 
 private:
-    bitset<64> black;
-    bitset<64> taken;
+    Bits black;
+    Bits taken;
 
     bool occupied(int x, int y);
-    bool get(Side side, int x, int y);
-    void set(Side side, int x, int y);
-    bool onBoard(int x, int y);
 
 public:
-    Board();
-    ~Board();
-    Board *copy();
+    BasicBoard();
+    ~BasicBoard();
+    BasicBoard *copy();
 
     bool isDone();
     bool hasMoves(Side side);
+    Bits legalMoves(Side side);
+    void legalMoves(Bits *blackMoves, Bits *whiteMoves);
+    BasicMoveList<N> getMoves(Side side);
     bool checkMove(Move *m, Side side);
     void doMove(Move *m, Side side);
     int count(Side side);
@@ -31,7 +97,16 @@ public:
     int getScore(Side side, bool testingMinimax);
     static Position getSquarePosition(int x, int y);
 
+    Bits getBits(Side side);
+    void setBits(Bits blackBits, Bits whiteBits);
     void setBoard(char data[]);
 };
 
+// The sizes board.cpp compiles
+extern template class BasicBoard<8>;
+extern template class BasicBoard<10>;
+
+typedef BasicBoard<BOARD_SIZE> Board;
+typedef BasicMoveList<BOARD_SIZE> MoveList;
+
 #endif
@@ -4,7 +4,12 @@
 #include <iostream>
 #include <string>
 
+// The engine plays on BOARD_SIZE x BOARD_SIZE boards; builds for other
+// sizes define it on the command line (see the Makefile's qwerty10)
+#ifndef BOARD_SIZE
 #define BOARD_SIZE (8)
+#endif
+#define BOARD_SQUARES (BOARD_SIZE * BOARD_SIZE)
 
 enum Side { 
     WHITE, BLACK
@@ -0,0 +1,110 @@
+#include "database.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+WthorFile::WthorFile() {
+    data = nullptr;
+    length = 0;
+    games = 0;
+    gamesYear = 0;
+}
+
+WthorFile::~WthorFile() {
+    close();
+}
+
+/*
+ * Maps a .wtb file and checks its header. Returns false if the file cannot be
+ * mapped, is not for 8x8 boards, or is shorter than its header says.
+ */
+bool WthorFile::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < WTHOR_HEADER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = static_cast<const uint8_t *>(mapped);
+    length = st.st_size;
+
+    // The header is little-endian: the game count is at byte 4, the year of
+    // the games at byte 10 and the board size (0 also meaning 8) at byte 12.
+    games = data[4] | data[5] << 8 | data[6] << 16 | (size_t) data[7] << 24;
+    gamesYear = data[10] | data[11] << 8;
+    int boardSize = data[12];
+    if ((boardSize != 0 && boardSize != BOARD_SIZE)
+            || games > (length - WTHOR_HEADER_BYTES) / WTHOR_GAME_BYTES) {
+        close();
+        return false;
+    }
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    return true;
+}
+
+void WthorFile::close() {
+    if (data != nullptr) munmap(const_cast<uint8_t *>(data), length);
+    data = nullptr;
+    length = 0;
+    games = 0;
+}
+
+/*
+ * Replays a game through Board::doMove and appends a record for every
+ * position in which a move was played, passes included, all labeled with the
+ * game's final disc difference. Returns the number of records added, or -1 if
+ * the game contains an illegal move, in which case nothing is added.
+ */
+int replayWthorGame(const WthorGame *game, std::vector<PositionRecord> &records) {
+    size_t first = records.size();
+    Board board;
+    Side turn = BLACK;
+    for (int i = 0; i < WTHOR_MOVES && game->moves[i] != 0; i++) {
+        int x = game->moves[i] % 10 - 1;
+        int y = game->moves[i] / 10 - 1;
+        if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) {
+            records.resize(first);
+            return -1;
+        }
+
+        // A side with no legal move passes; the file does not say so.
+        Move move(x, y);
+        if (!board.hasMoves(turn)) {
+            PositionRecord pass;
+            memset(&pass, 0, sizeof(pass));
+            pass.black = board.getBits(BLACK);
+            pass.white = board.getBits(WHITE);
+            pass.side = turn;
+            pass.move = -1;
+            records.push_back(pass);
+            turn = (turn == BLACK) ? WHITE : BLACK;
+        }
+        if (!board.checkMove(&move, turn)) {
+            records.resize(first);
+            return -1;
+        }
+
+        PositionRecord record;
+        memset(&record, 0, sizeof(record));
+        record.black = board.getBits(BLACK);
+        record.white = board.getBits(WHITE);
+        record.side = turn;
+        record.move = x + 8 * y;
+        records.push_back(record);
+        board.doMove(&move, turn);
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+
+    int result = board.countBlack() - board.countWhite();
+    for (size_t i = first; i < records.size(); i++) {
+        records[i].result = result;
+    }
+    return records.size() - first;
+}
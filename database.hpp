@@ -0,0 +1,61 @@
+#ifndef __DATABASE_H__
+#define __DATABASE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common.hpp"
+#include "board.hpp"
+#include "record.hpp"
+
+// Sizes of the parts of a WTHOR game database (.wtb) file
+#define WTHOR_HEADER_BYTES (16)
+#define WTHOR_GAME_BYTES (68)
+#define WTHOR_MOVES (60)
+
+/*
+ * One game as stored in a .wtb file. Moves are 10 * row + column with both
+ * counting from 1 (f5 is 56); 0 ends a game that finished early. Passes are
+ * not stored.
+ */
+struct WthorGame {
+    uint8_t tournament[2];
+    uint8_t blackPlayer[2];
+    uint8_t whitePlayer[2];
+    uint8_t blackScore;         // black's discs at the end, empties to the winner
+    uint8_t theoreticalScore;   // black's discs with perfect play from the end depth
+    uint8_t moves[WTHOR_MOVES];
+};
+
+static_assert(sizeof(WthorGame) == WTHOR_GAME_BYTES, "WthorGame must match the file layout");
+
+/*
+ * A WTHOR game database mapped read-only into memory. Games are read in place
+ * straight from the mapping; nothing is copied or parsed up front beyond the
+ * header.
+ */
+class WthorFile {
+
+public:
+    WthorFile();
+    ~WthorFile();
+
+    bool open(const char *path);
+    void close();
+
+    size_t gameCount() { return games; }
+    int year() { return gamesYear; }
+    const WthorGame *game(size_t index) {
+        return reinterpret_cast<const WthorGame *>(data + WTHOR_HEADER_BYTES) + index;
+    }
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t games;
+    int gamesYear;
+};
+
+int replayWthorGame(const WthorGame *game, std::vector<PositionRecord> &records);
+
+#endif
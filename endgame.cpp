@@ -0,0 +1,113 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Solves a suite of endgame positions exactly and checks each result against
+ * the known best score. Reports time, nodes and nodes per second for every
+ * position and for the whole suite, and exits non-zero if any score is wrong.
+ */
+
+struct EndgamePosition {
+    string name;
+    Board board;
+    Side side;
+    int expected;
+};
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-f suite] [-e maxEmpties] [names...]" << endl;
+    cerr << "suite lines: 64 squares of X/O/-, side to move, best disc difference, name" << endl;
+    exit(-1);
+}
+
+static string moveName(Move *move) {
+    if (move == nullptr) return "pass";
+    return string(1, (char) ('a' + move->getX())) + (char) ('1' + move->getY());
+}
+
+int main(int argc, char *argv[]) {
+    const char *suiteFile = "endgame.txt";
+    int maxEmpties = 64;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:e:")) != -1) {
+        switch (opt) {
+            case 'f': suiteFile = optarg; break;
+            case 'e': maxEmpties = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+
+    ifstream in(suiteFile);
+    if (!in) {
+        cerr << "endgame: cannot read " << suiteFile << endl;
+        exit(-1);
+    }
+    vector<EndgamePosition> suite;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        EndgamePosition pos;
+        string squares, side;
+        stringstream fields(line);
+        fields >> squares >> side >> pos.expected >> pos.name;
+        if (fields.fail() || !parsePosition(squares + side, &pos.board, &pos.side)) {
+            cerr << "endgame: bad line: " << line << endl;
+            exit(-1);
+        }
+
+        // Names on the command line pick positions out of the suite.
+        bool wanted = (optind == argc);
+        for (int i = optind; i < argc; i++) {
+            wanted = wanted || pos.name == argv[i];
+        }
+        int empties = 64 - pos.board.countBlack() - pos.board.countWhite();
+        if (wanted && empties <= maxEmpties) suite.push_back(pos);
+    }
+
+    cout << fixed << setprecision(3);
+    cout << "name        empties  score  best  move      time s         nodes       nodes/s" << endl;
+    int wrong = 0;
+    unsigned long long totalNodes = 0;
+    double totalSeconds = 0.0;
+    //emptied for every position, so each is timed on its own
+    EndgameTable table(ENDGAME_TT_BYTES);
+    for (size_t i = 0; i < suite.size(); i++) {
+        EndgamePosition &pos = suite[i];
+        Player player(pos.side);
+        player.setBoard(pos.board.copy());
+        table.clear();
+        player.setEndgameTable(&table);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        pair<int, Move*> result = player.solveEndgame();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        unsigned long long nodes = player.getLastNodes();
+        totalNodes += nodes;
+        totalSeconds += seconds;
+
+        bool ok = (result.first == pos.expected);
+        if (!ok) wrong++;
+        cout << left << setw(12) << pos.name << right
+             << setw(7) << 64 - pos.board.countBlack() - pos.board.countWhite()
+             << setw(7) << result.first << setw(6) << pos.expected
+             << "  " << left << setw(5) << moveName(result.second) << right
+             << setw(11) << seconds << setw(14) << nodes
+             << setw(14) << (long long) (nodes / max(seconds, 1e-9))
+             << (ok ? "" : "  WRONG") << endl;
+        delete result.second;
+    }
+
+    cout << "total: " << suite.size() << " positions, " << wrong << " wrong, "
+         << totalSeconds << " s, " << totalNodes << " nodes, "
+         << (long long) (totalNodes / max(totalSeconds, 1e-9)) << " nodes/s" << endl;
+    return wrong == 0 ? 0 : 1;
+}
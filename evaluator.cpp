@@ -0,0 +1,58 @@
+#include "evaluator.hpp"
+
+static const char *EVAL_NAMES[EVAL_KIND_COUNT] = { "weighted", "mobility" };
+
+int WeightedEvaluator::evaluate(Board *board, Side side) {
+    return board->getScore(side, false);
+}
+
+int MobilityEvaluator::evaluate(Board *board, Side side) {
+    Board::Bits blackMoves, whiteMoves;
+    board->legalMoves(&blackMoves, &whiteMoves);
+    return evaluateWithMoves(board, side, blackMoves, whiteMoves);
+}
+
+int MobilityEvaluator::evaluateWithMoves(Board *board, Side side, Board::Bits blackMoves,
+        Board::Bits whiteMoves) {
+    int mobility = countSquares(blackMoves) - countSquares(whiteMoves);
+    if (side == WHITE) mobility = -mobility;
+    return board->getScore(side, false) + MOBILITY_WEIGHT * mobility;
+}
+
+/*
+ * Returns the shared instance of an evaluator, or nullptr for EVAL_NONE.
+ */
+Evaluator *getEvaluator(EvalKind kind) {
+    static WeightedEvaluator weighted;
+    static MobilityEvaluator mobility;
+    switch (kind) {
+        case EVAL_WEIGHTED: return &weighted;
+        case EVAL_MOBILITY: return &mobility;
+        default: return nullptr;
+    }
+}
+
+/*
+ * The name engine specs use for an evaluator.
+ */
+const char *evalKindName(EvalKind kind) {
+    return kind >= 0 && kind < EVAL_KIND_COUNT ? EVAL_NAMES[kind] : "none";
+}
+
+/*
+ * Reads an evaluator name as written by evalKindName. Returns false if there
+ * is no evaluator by that name.
+ */
+bool parseEvalKind(const std::string &name, EvalKind *kind) {
+    if (name == "none") {
+        *kind = EVAL_NONE;
+        return true;
+    }
+    for (int k = 0; k < EVAL_KIND_COUNT; k++) {
+        if (name == EVAL_NAMES[k]) {
+            *kind = (EvalKind) k;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,65 @@
+#ifndef __EVALUATOR_H__
+#define __EVALUATOR_H__
+
+#include <string>
+#include "common.hpp"
+#include "board.hpp"
+
+// How much one legal move more than the opponent is worth to MobilityEvaluator,
+// in the units of the square weights
+#define MOBILITY_WEIGHT (2)
+
+/*
+ * The evaluators a player can be set up with. EVAL_NONE stands for no
+ * evaluator where one is optional.
+ */
+enum EvalKind {
+    EVAL_NONE = -1, EVAL_WEIGHTED, EVAL_MOBILITY, EVAL_KIND_COUNT
+};
+
+/*
+ * Scores an unfinished position from the point of view of the given side,
+ * higher being better for it. The search uses evaluators in two tiers: a
+ * cheap one to decide which moves to try first, called for every child of an
+ * interior node, and a richer one only at the leaves, where its cost is paid
+ * once per position that actually ends a line. Evaluators keep no state, so
+ * one instance is shared by every player and thread. A caller that already
+ * has both sides' legal moves can pass them in, for evaluators that need them.
+ */
+class Evaluator {
+
+public:
+    virtual ~Evaluator() {}
+    virtual int evaluate(Board *board, Side side) = 0;
+    virtual int evaluateWithMoves(Board *board, Side side, Board::Bits blackMoves,
+            Board::Bits whiteMoves) {
+        return evaluate(board, side);
+    }
+};
+
+/*
+ * The square weights of Board::getScore: a few popcounts over constant masks.
+ */
+class WeightedEvaluator : public Evaluator {
+
+public:
+    int evaluate(Board *board, Side side);
+};
+
+/*
+ * The square weights plus the difference in legal moves, which costs a full
+ * move generation for both sides.
+ */
+class MobilityEvaluator : public Evaluator {
+
+public:
+    int evaluate(Board *board, Side side);
+    int evaluateWithMoves(Board *board, Side side, Board::Bits blackMoves,
+        Board::Bits whiteMoves);
+};
+
+Evaluator *getEvaluator(EvalKind kind);
+const char *evalKindName(EvalKind kind);
+bool parseEvalKind(const std::string &name, EvalKind *kind);
+
+#endif
@@ -0,0 +1,546 @@
+#include "game.hpp"
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Default configuration: the competition search with the weighted heuristic.
+ */
+EngineConfig::EngineConfig() {
+    depth = DEFAULT_SEARCH_DEPTH;
+    discEval = false;
+    endgameEmpties = DEFAULT_ENDGAME_EMPTIES;
+    iidDepth = DEFAULT_IID_DEPTH;
+    iidReduction = DEFAULT_IID_REDUCTION;
+    leafEval = DEFAULT_LEAF_EVAL;
+    orderEval = DEFAULT_ORDER_EVAL;
+    ttMB = DEFAULT_TT_MB;
+}
+
+/*
+ * Reads settings from a "key=value,key=value" string, leaving unmentioned
+ * settings alone. Returns false on an unknown key or bad value.
+ */
+bool EngineConfig::parse(const string &spec) {
+    stringstream in(spec);
+    string item;
+    while (getline(in, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == string::npos) return false;
+        string key = item.substr(0, eq);
+        string value = item.substr(eq + 1);
+        if (key == "depth") {
+            depth = atoi(value.c_str());
+            if (depth < 1) return false;
+        } else if (key == "eval") {
+            discEval = (value == "discs");
+            if (!discEval && (!parseEvalKind(value, &leafEval) || leafEval == EVAL_NONE)) {
+                return false;
+            }
+        } else if (key == "order") {
+            if (!parseEvalKind(value, &orderEval)) return false;
+        } else if (key == "endgame") {
+            endgameEmpties = atoi(value.c_str());
+        } else if (key == "iid") {
+            iidDepth = atoi(value.c_str());
+            if (iidDepth < 0) return false;
+        } else if (key == "iidreduce") {
+            iidReduction = atoi(value.c_str());
+            if (iidReduction < 1) return false;
+        } else if (key == "tt") {
+            if (value.empty() || value.find_first_not_of("0123456789") != string::npos) {
+                return false;
+            }
+            ttMB = strtoul(value.c_str(), nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Formats the configuration the way parse() reads it.
+ */
+string EngineConfig::toString() const {
+    return "depth=" + to_string(depth) + ",eval=" + (discEval ? "discs" : evalKindName(leafEval))
+            + ",order=" + evalKindName(orderEval) + ",endgame=" + to_string(endgameEmpties)
+            + ",iid=" + to_string(iidDepth) + ",iidreduce=" + to_string(iidReduction)
+            + ",tt=" + to_string(ttMB);
+}
+
+PlayerEngine::PlayerEngine(const EngineConfig &config) {
+    this->config = config;
+    this->player = nullptr;
+    this->table = nullptr;
+    this->endgameTable = nullptr;
+}
+
+PlayerEngine::~PlayerEngine() {
+    delete player;
+    delete table;
+    delete endgameTable;
+}
+
+/*
+ * Sets up a fresh player for a new game, with new tables the way a new qwerty
+ * process has them. Mapping fresh tables is cheaper than clearing the old
+ * ones, which would touch every page.
+ */
+bool PlayerEngine::start(Side side, const vector<int> &opening) {
+    delete player;
+    delete table;
+    delete endgameTable;
+    table = (config.ttMB > 0) ? new TranspositionTable(config.ttMB << 20) : nullptr;
+    endgameTable = new EndgameTable(ENDGAME_TT_BYTES);
+    player = new Player(side);
+    player->setTranspositionTable(table);
+    player->setEndgameTable(endgameTable);
+    player->testingMinimax = config.discEval;
+    player->setSearchDepth(config.depth);
+    player->setEndgameEmpties(config.endgameEmpties);
+    player->setInternalDeepening(config.iidDepth, config.iidReduction);
+    player->setEvaluators(config.leafEval, config.orderEval);
+    Board *board = new Board();
+    applyOpening(board, opening);
+    player->setBoard(board);
+    return true;
+}
+
+Move *PlayerEngine::doMove(Move *opponentsMove, int msLeft) {
+    return player->doMove(opponentsMove, msLeft);
+}
+
+ProcessEngine::ProcessEngine(const string &command, bool socket) {
+    this->command = command;
+    this->socket = socket;
+    pid = -1;
+    toEngine = fromEngine = -1;
+    failed = false;
+}
+
+ProcessEngine::~ProcessEngine() {
+    stop();
+}
+
+/*
+ * Kills the engine process from the previous game, if any.
+ */
+void ProcessEngine::stop() {
+    if (toEngine >= 0) close(toEngine);
+    if (fromEngine >= 0) close(fromEngine);
+    toEngine = fromEngine = -1;
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    pid = -1;
+    buffer.clear();
+}
+
+/*
+ * Reads one line from the engine, waiting at most timeoutMs milliseconds (or
+ * forever if timeoutMs is negative). Returns false on timeout or end of file.
+ */
+bool ProcessEngine::readLine(string &line, int timeoutMs) {
+    chrono::steady_clock::time_point deadline =
+            chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    size_t newline;
+    while ((newline = buffer.find('\n')) == string::npos) {
+        int wait = -1;
+        if (timeoutMs >= 0) {
+            wait = chrono::duration_cast<chrono::milliseconds>(
+                    deadline - chrono::steady_clock::now()).count();
+            if (wait < 0) return false;
+        }
+        struct pollfd pfd = { fromEngine, POLLIN, 0 };
+        int ready = poll(&pfd, 1, wait);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return false;
+
+        char chunk[256];
+        ssize_t got = read(fromEngine, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        buffer.append(chunk, got);
+    }
+    line = buffer.substr(0, newline);
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+/*
+ * Starts a new engine process for a game and waits for it to report that it
+ * has initialized, allowing the same 30 seconds OthelloGame does. The
+ * engine's stderr is discarded.
+ */
+bool ProcessEngine::start(Side side, const vector<int> &opening) {
+    stop();
+    failed = true;
+
+    string args = (side == BLACK) ? "Black" : "White";
+    if (!opening.empty()) args += " " + formatOpening(opening);
+    if (socket) {
+        if (!connectServer(args + "\n")) {
+            stop();
+            return false;
+        }
+        failed = false;
+        return true;
+    }
+    string full = "exec " + command + " " + args;
+
+    // Close-on-exec keeps engines started by other threads from inheriting
+    // these pipes and holding them open.
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0) return false;
+    if (pipe2(out, O_CLOEXEC) < 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(in[0], 0);
+        dup2(out[1], 1);
+        if (devNull >= 0) dup2(devNull, 2);
+        execl("/bin/sh", "sh", "-c", full.c_str(), (char *) nullptr);
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    toEngine = in[1];
+    fromEngine = out[0];
+    if (pid < 0) {
+        stop();
+        return false;
+    }
+
+    string line;
+    if (!readLine(line, 30000)) {
+        stop();
+        return false;
+    }
+    failed = false;
+    return true;
+}
+
+/*
+ * Connects to the engine server listening on the socket path, sends it the
+ * game's arguments and waits for it to report that the game is set up.
+ */
+bool ProcessEngine::connectServer(const string &hello) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (command.size() >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, command.c_str());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+    toEngine = fd;
+    fromEngine = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (fromEngine < 0) return false;
+
+    string line;
+    return writeAll(hello) && readLine(line, 30000);
+}
+
+/*
+ * Writes all of data to the engine. Returns false if the engine has gone.
+ */
+bool ProcessEngine::writeAll(const string &data) {
+    const char *next = data.c_str();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t written = write(toEngine, next, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        next += written;
+        left -= written;
+    }
+    return true;
+}
+
+/*
+ * Sends the opponent's move and the clock to the engine and reads its reply.
+ * A timed engine is given a little slack past msLeft to answer, so that an
+ * overrun is reported as a timeout by the referee rather than a hang.
+ */
+Move *ProcessEngine::doMove(Move *opponentsMove, int msLeft) {
+    if (failed) return nullptr;
+
+    string request = (opponentsMove == nullptr) ? string("-1 -1")
+            : to_string(opponentsMove->getX()) + " " + to_string(opponentsMove->getY());
+    request += " " + to_string(msLeft) + "\n";
+    if (!writeAll(request)) {
+        failed = true;
+        return nullptr;
+    }
+
+    string line;
+    int x, y;
+    if (!readLine(line, msLeft >= 0 ? msLeft + 1000 : -1)
+            || sscanf(line.c_str(), "%d %d", &x, &y) != 2) {
+        failed = true;
+        return nullptr;
+    }
+    if (x < 0 || y < 0) return nullptr;
+    if (x >= BOARD_SIZE || y >= BOARD_SIZE) {
+        failed = true;
+        return nullptr;
+    }
+    return new Move(x, y);
+}
+
+/*
+ * Makes an engine from a command line spec: "cmd:<command>" runs an engine
+ * binary as a child process, "unix:<path>" plays through an engine server,
+ * anything else is an EngineConfig for an in-process player. Returns nullptr
+ * if the spec does not parse.
+ */
+Engine *createEngine(const string &spec) {
+    if (spec.compare(0, 4, "cmd:") == 0) {
+        return new ProcessEngine(spec.substr(4));
+    }
+    if (spec.compare(0, 5, "unix:") == 0) {
+        return new ProcessEngine(spec.substr(5), true);
+    }
+    EngineConfig config;
+    if (!config.parse(spec)) return nullptr;
+    return new PlayerEngine(config);
+}
+
+/*
+ * Reads an opening written in the usual notation, e.g. "f5d6c3", where the
+ * letter is the column (x) and the number the row (y), two digits for the
+ * rows past 9 of a larger board. Returns false if the text is malformed;
+ * legality is not checked.
+ */
+bool parseOpening(const string &text, vector<int> &opening) {
+    opening.clear();
+    size_t i = 0;
+    while (i < text.size()) {
+        int x = tolower(text[i++]) - 'a';
+        int row = 0, digits = 0;
+        while (i < text.size() && isdigit(text[i]) && digits < 2) {
+            row = row * 10 + (text[i++] - '0');
+            digits++;
+        }
+        int y = row - 1;
+        if (digits == 0 || x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) return false;
+        opening.push_back(x + BOARD_SIZE * y);
+    }
+    return true;
+}
+
+/*
+ * Writes an opening in the notation parseOpening reads.
+ */
+string formatOpening(const vector<int> &opening) {
+    string text;
+    for (size_t i = 0; i < opening.size(); i++) {
+        text += (char) ('a' + opening[i] % BOARD_SIZE);
+        text += to_string(opening[i] / BOARD_SIZE + 1);
+    }
+    return text;
+}
+
+/*
+ * Loads an opening file with one opening per line. Blank lines and lines
+ * starting with '#' are skipped. Returns false if the file cannot be read or
+ * a line does not parse.
+ */
+bool loadOpenings(const char *path, vector<vector<int> > &openings) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if (line.empty() || line[0] == '#') continue;
+        vector<int> opening;
+        if (!parseOpening(line, opening)) return false;
+        openings.push_back(opening);
+    }
+    return true;
+}
+
+/*
+ * Reads a position written as its BOARD_SQUARES squares row by row, 'X' (or 'b') for
+ * black, 'O' (or 'w') for white and '-' (or '.') for empty, followed by the
+ * side to move in the same letters. Whitespace is ignored, so the squares may
+ * be split over several lines. Returns false if the text is malformed.
+ */
+bool parsePosition(const string &text, Board *board, Side *toMove) {
+    Board::Bits bits[2] = { 0, 0 };
+    int square = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = toupper(text[i]);
+        if (isspace(c)) continue;
+        bool isBlack = (c == 'X' || c == 'B');
+        bool isWhite = (c == 'O' || c == 'W');
+        if (square == BOARD_SQUARES) {
+            if (!isBlack && !isWhite) return false;
+            board->setBits(bits[BLACK], bits[WHITE]);
+            *toMove = isBlack ? BLACK : WHITE;
+            return true;
+        }
+        if (isBlack) bits[BLACK] |= (Board::Bits) 1 << square;
+        else if (isWhite) bits[WHITE] |= (Board::Bits) 1 << square;
+        else if (c != '-' && c != '.') return false;
+        square++;
+    }
+    return false;
+}
+
+/*
+ * Writes a position on one line in the form parsePosition reads.
+ */
+string formatPosition(Board *board, Side toMove) {
+    Board::Bits black = board->getBits(BLACK);
+    Board::Bits white = board->getBits(WHITE);
+    string text;
+    for (int i = 0; i < BOARD_SQUARES; i++) {
+        text += (black >> i & 1) ? 'X' : (white >> i & 1) ? 'O' : '-';
+    }
+    text += (toMove == BLACK) ? " X" : " O";
+    return text;
+}
+
+/*
+ * Returns 1 if black won, -1 if white won and 0 for a draw. A player that
+ * errored or ran out of time loses regardless of the discs on the board.
+ */
+int GameResult::winner() const {
+    if (conclusion == BLACK_ERROR_CONCLUSION) return -1;
+    if (conclusion == WHITE_ERROR_CONCLUSION) return 1;
+    return (blackScore > whiteScore) - (blackScore < whiteScore);
+}
+
+/*
+ * Plays a list of opening squares (x + BOARD_SIZE*y) onto the board starting with
+ * black, passing automatically for a side with no legal move. Returns the side
+ * to move afterwards.
+ */
+Side applyOpening(Board *board, const vector<int> &opening) {
+    Side turn = BLACK;
+    for (size_t i = 0; i < opening.size(); i++) {
+        if (!board->hasMoves(turn)) {
+            turn = (turn == BLACK) ? WHITE : BLACK;
+        }
+        Move move(opening[i] % BOARD_SIZE, opening[i] / BOARD_SIZE);
+        board->doMove(&move, turn);
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    if (!board->hasMoves(turn) && !board->isDone()) {
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    return turn;
+}
+
+/*
+ * Picks up to the given number of uniformly random legal moves from the
+ * starting position.
+ */
+vector<int> randomOpening(int plies, mt19937 &rng) {
+    vector<int> opening;
+    Board board;
+    Side turn = BLACK;
+    for (int ply = 0; ply < plies && !board.isDone(); ply++) {
+        if (!board.hasMoves(turn)) {
+            turn = (turn == BLACK) ? WHITE : BLACK;
+        }
+        MoveList legal = board.getMoves(turn);
+        int square = legal.squares[rng() % legal.count];
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        board.doMove(&move, turn);
+        opening.push_back(square);
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    return opening;
+}
+
+/*
+ * Plays a game between two engines from the given opening, refereed the way
+ * OthelloGame does it: each side gets msPerGame milliseconds in total (or no
+ * limit if msPerGame is not positive), and a side that runs out of time or
+ * returns an illegal move loses.
+ */
+GameResult playGame(Engine *black, Engine *white, const vector<int> &opening, long msPerGame) {
+    GameResult result;
+    result.conclusion = NORMAL_CONCLUSION;
+    result.blackScore = result.whiteScore = 0;
+    result.blackMicros = result.whiteMicros = 0;
+    result.timedOut = false;
+
+    if (!black->start(BLACK, opening)) {
+        result.conclusion = BLACK_ERROR_CONCLUSION;
+        return result;
+    }
+    if (!white->start(WHITE, opening)) {
+        result.conclusion = WHITE_ERROR_CONCLUSION;
+        return result;
+    }
+
+    Board board;
+    Side turn = applyOpening(&board, opening);
+    //the clocks run in microseconds, since a fast engine's moves each take
+    //well under a millisecond and would otherwise never be charged
+    bool timed = msPerGame > 0;
+    long usLeft[2] = { msPerGame * 1000, msPerGame * 1000 };
+    Move *lastMove = nullptr;
+    while (!board.isDone()) {
+        Engine *engine = (turn == BLACK) ? black : white;
+        Conclusion loss = (turn == BLACK) ? BLACK_ERROR_CONCLUSION : WHITE_ERROR_CONCLUSION;
+        if (timed && usLeft[turn] <= 0) {
+            result.conclusion = loss;
+            result.timedOut = true;
+            break;
+        }
+
+        //engines count in whole milliseconds, and one that is down to its
+        //last fraction of one still gets 1, as 0 would mean no limit at all
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Move *move = engine->doMove(lastMove, timed ? max(usLeft[turn] / 1000, 1L) : -1);
+        long elapsed = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - start).count();
+        ((turn == BLACK) ? result.blackMicros : result.whiteMicros) += elapsed;
+
+        bool late = timed && elapsed > usLeft[turn];
+        if (timed) usLeft[turn] -= elapsed;
+        if (late || engine->hasFailed() || !board.checkMove(move, turn)) {
+            result.conclusion = loss;
+            result.timedOut = late;
+            delete move;
+            break;
+        }
+
+        board.doMove(move, turn);
+        delete lastMove;
+        lastMove = move;
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    delete lastMove;
+
+    result.blackScore = board.countBlack();
+    result.whiteScore = board.countWhite();
+    return result;
+}
@@ -0,0 +1,133 @@
+#ifndef __GAME_H__
+#define __GAME_H__
+
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "common.hpp"
+#include "board.hpp"
+#include "player.hpp"
+using namespace std;
+
+/*
+ * Search settings for an in-process engine, written on the command line as
+ * comma separated key=value pairs, e.g. "depth=6,eval=discs,endgame=12".
+ * eval is the leaf evaluation, discs or one of the evaluators, and order the
+ * evaluator moves are ordered by, or none. tt is the size of the engine's
+ * transposition table in MB, 0 for none. Like qwerty, every PlayerEngine has
+ * its own table and endgame table, fresh for each game; server and analyze
+ * share one of this size between all their games.
+ */
+struct EngineConfig {
+    int depth;
+    bool discEval;
+    int endgameEmpties;
+    int iidDepth;
+    int iidReduction;
+    EvalKind leafEval;
+    EvalKind orderEval;
+    size_t ttMB;
+
+    EngineConfig();
+    bool parse(const string &spec);
+    string toString() const;
+};
+
+/*
+ * Something that can play one side of a game. start() is called once per game
+ * with the opening moves already on the board; afterwards doMove follows the
+ * same contract as Player::doMove.
+ */
+class Engine {
+
+public:
+    virtual ~Engine() {}
+    virtual bool start(Side side, const vector<int> &opening) = 0;
+    virtual Move *doMove(Move *opponentsMove, int msLeft) = 0;
+    // True if the engine crashed or broke protocol during the last call
+    virtual bool hasFailed() { return false; }
+};
+
+/*
+ * An Engine backed by a Player running in this process.
+ */
+class PlayerEngine : public Engine {
+
+public:
+    PlayerEngine(const EngineConfig &config);
+    ~PlayerEngine();
+
+    bool start(Side side, const vector<int> &opening);
+    Move *doMove(Move *opponentsMove, int msLeft);
+    Player *getPlayer() { return player; }
+
+private:
+    EngineConfig config;
+    Player *player;
+    TranspositionTable *table;
+    EndgameTable *endgameTable;
+};
+
+/*
+ * An Engine running as a child process that speaks the wrapper.cpp protocol
+ * on its stdin and stdout. A new process is started for every game, the same
+ * way WrapperPlayer does it, with the opening passed as an extra argument.
+ *
+ * With a socket path instead of a command, every game is a new connection to
+ * an engine server, which is sent the same arguments on the first line.
+ */
+class ProcessEngine : public Engine {
+
+public:
+    ProcessEngine(const string &command, bool socket = false);
+    ~ProcessEngine();
+
+    bool start(Side side, const vector<int> &opening);
+    Move *doMove(Move *opponentsMove, int msLeft);
+    bool hasFailed() { return failed; }
+
+private:
+    string command;
+    bool socket;
+    pid_t pid;
+    int toEngine;
+    int fromEngine;
+    string buffer;
+    bool failed;
+
+    void stop();
+    bool connectServer(const string &hello);
+    bool writeAll(const string &data);
+    bool readLine(string &line, int timeoutMs);
+};
+
+// Reasons a game can end, matching OthelloResult's conclusions.
+enum Conclusion {
+    NORMAL_CONCLUSION, BLACK_ERROR_CONCLUSION, WHITE_ERROR_CONCLUSION
+};
+
+/*
+ * Outcome of one game.
+ */
+struct GameResult {
+    Conclusion conclusion;
+    int blackScore, whiteScore;
+    // Time each side spent on its moves, in microseconds
+    long blackMicros, whiteMicros;
+    bool timedOut;
+
+    int winner() const;
+};
+
+Engine *createEngine(const string &spec);
+bool parseOpening(const string &text, vector<int> &opening);
+string formatOpening(const vector<int> &opening);
+bool loadOpenings(const char *path, vector<vector<int> > &openings);
+bool parsePosition(const string &text, Board *board, Side *toMove);
+string formatPosition(Board *board, Side toMove);
+Side applyOpening(Board *board, const vector<int> &opening);
+vector<int> randomOpening(int plies, mt19937 &rng);
+GameResult playGame(Engine *black, Engine *white, const vector<int> &opening, long msPerGame);
+
+#endif
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Totals for one engine over the whole match.
+ */
+struct EngineStats {
+    int wins, losses, draws;
+    int errors, timeouts;
+    long discs, discDiff;
+    long timeMicros;
+};
+
+static string specs[2];
+static int games;
+static int randomPlies;
+static long msPerGame;
+static unsigned int seed;
+
+static atomic<int> nextGame(0);
+static mutex statsLock;
+static EngineStats stats[2];
+static int gamesDone;
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-n games] [-j threads] [-t msPerGame]"
+         << " [-r randomPlies] [-s seed] engineA engineB" << endl;
+    cerr << "engines are key=value lists, e.g. depth=6,eval=discs, or"
+         << " cmd:<command> for an engine binary, or unix:<path> for an engine server" << endl;
+    exit(-1);
+}
+
+/*
+ * Adds one game to an engine's totals, from that engine's point of view.
+ */
+static void record(EngineStats &s, int outcome, int mine, int theirs,
+        bool myError, bool timedOut, long timeMicros) {
+    if (outcome > 0) s.wins++;
+    else if (outcome < 0) s.losses++;
+    else s.draws++;
+    if (myError) {
+        s.errors++;
+        if (timedOut) s.timeouts++;
+    }
+    s.discs += mine;
+    s.discDiff += mine - theirs;
+    s.timeMicros += timeMicros;
+}
+
+static void printStats(ostream &out) {
+    for (int e = 0; e < 2; e++) {
+        EngineStats &s = stats[e];
+        double score = (s.wins + 0.5 * s.draws) / max(gamesDone, 1);
+        out << (e == 0 ? "A" : "B") << " [" << specs[e] << "]: "
+            << s.wins << "W " << s.losses << "L " << s.draws << "D ("
+            << 100.0 * score << "%), "
+            << (double) s.discs / max(gamesDone, 1) << " discs/game, "
+            << (double) s.discDiff / max(gamesDone, 1) << " disc diff/game, "
+            << s.errors << " errors (" << s.timeouts << " timeouts), "
+            << s.timeMicros / 1000.0 / max(gamesDone, 1) << " ms/game" << endl;
+    }
+}
+
+/*
+ * Worker thread body. Games are played in pairs from the same opening with
+ * the colors swapped, so an unbalanced opening favors neither engine.
+ */
+static void worker() {
+    Engine *engines[2] = { createEngine(specs[0]), createEngine(specs[1]) };
+    int game;
+    while ((game = nextGame++) < games) {
+        mt19937 rng(seed + game / 2);
+        vector<int> opening = randomOpening(randomPlies, rng);
+        int blackEngine = game % 2;
+        int whiteEngine = 1 - blackEngine;
+        GameResult r = playGame(engines[blackEngine], engines[whiteEngine], opening, msPerGame);
+
+        lock_guard<mutex> guard(statsLock);
+        int outcome = r.winner();
+        record(stats[blackEngine], outcome, r.blackScore, r.whiteScore,
+                r.conclusion == BLACK_ERROR_CONCLUSION, r.timedOut, r.blackMicros);
+        record(stats[whiteEngine], -outcome, r.whiteScore, r.blackScore,
+                r.conclusion == WHITE_ERROR_CONCLUSION, r.timedOut, r.whiteMicros);
+        gamesDone++;
+        if (gamesDone % 100 == 0) {
+            cerr << gamesDone << " games played" << endl;
+            printStats(cerr);
+        }
+    }
+    delete engines[0];
+    delete engines[1];
+}
+
+int main(int argc, char *argv[]) {
+    games = 100;
+    randomPlies = 6;
+    msPerGame = -1;
+    seed = 1;
+    int threads = thread::hardware_concurrency();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:t:r:s:")) != -1) {
+        switch (opt) {
+            case 'n': games = atoi(optarg); break;
+            case 'j': threads = atoi(optarg); break;
+            case 't': msPerGame = atol(optarg); break;
+            case 'r': randomPlies = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 2) usage(argv[0]);
+    for (int e = 0; e < 2; e++) {
+        specs[e] = argv[optind + e];
+        Engine *engine = createEngine(specs[e]);
+        if (engine == nullptr) {
+            cerr << "match: bad engine " << specs[e] << endl;
+            usage(argv[0]);
+        }
+        delete engine;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (threads < 1) threads = 1;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread(worker));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << gamesDone << " games in " << seconds << " s on " << threads << " threads" << endl;
+    printStats(cout);
+    return 0;
+}
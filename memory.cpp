@@ -0,0 +1,85 @@
+#include "memory.hpp"
+
+MemoryBudget::MemoryBudget(size_t limit) {
+    this->limit = limit;
+    this->used = 0;
+}
+
+/*
+ * The budget everything in this process reserves from. Unlimited until
+ * someone sets a limit.
+ */
+MemoryBudget &MemoryBudget::process() {
+    static MemoryBudget budget(MEMORY_UNLIMITED);
+    return budget;
+}
+
+/*
+ * Reserves up to wanted bytes for a component. Returns how many bytes were
+ * granted: wanted if that much is available, otherwise whatever is left, or 0
+ * (and nothing is reserved) if that is less than minimum.
+ */
+size_t MemoryBudget::reserve(const std::string &component, size_t wanted, size_t minimum) {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t available = used < limit ? limit - used : 0;
+    size_t granted = wanted < available ? wanted : available;
+    if (granted < minimum || granted == 0) return 0;
+    used += granted;
+    components[component] += granted;
+    return granted;
+}
+
+/*
+ * Records memory a component has to have, whether or not the budget allows
+ * it.
+ */
+void MemoryBudget::charge(const std::string &component, size_t bytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    used += bytes;
+    components[component] += bytes;
+}
+
+/*
+ * Gives back memory reserved or charged earlier by the same component.
+ */
+void MemoryBudget::release(const std::string &component, size_t bytes) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::map<std::string, size_t>::iterator it = components.find(component);
+    if (it == components.end()) return;
+    if (bytes > it->second) bytes = it->second;
+    it->second -= bytes;
+    used -= bytes;
+    if (it->second == 0) components.erase(it);
+}
+
+/*
+ * Changes the limit. Memory already reserved is kept even if it is now over
+ * the limit; only later reservations see the new one.
+ */
+void MemoryBudget::setLimit(size_t limit) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->limit = limit;
+}
+
+size_t MemoryBudget::getLimit() {
+    std::lock_guard<std::mutex> guard(lock);
+    return limit;
+}
+
+size_t MemoryBudget::getUsed() {
+    std::lock_guard<std::mutex> guard(lock);
+    return used;
+}
+
+size_t MemoryBudget::getAvailable() {
+    std::lock_guard<std::mutex> guard(lock);
+    return used < limit ? limit - used : 0;
+}
+
+/*
+ * Bytes currently held by each component.
+ */
+std::map<std::string, size_t> MemoryBudget::getUsage() {
+    std::lock_guard<std::mutex> guard(lock);
+    return components;
+}
@@ -0,0 +1,56 @@
+#ifndef __MEMORY_H__
+#define __MEMORY_H__
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+// WrapperPlayer runs the engine under ulimit -m/-v 786432 (KB)
+#define DEFAULT_MEMORY_BUDGET_MB (768)
+// Part of the limit left for what the budget does not see: code, stacks,
+// the C++ runtime and small allocations
+#define MEMORY_HEADROOM_MB (64)
+// The transposition table may take up to 1/TT_BUDGET_SHARE of the memory
+// budget, leaving the rest for everything else the engine allocates
+#define TT_BUDGET_SHARE (2)
+// Transposition table size the engine asks for under the default budget
+#define DEFAULT_TT_MB ((DEFAULT_MEMORY_BUDGET_MB - MEMORY_HEADROOM_MB) / TT_BUDGET_SHARE)
+// Used as the limit when nothing was configured
+#define MEMORY_UNLIMITED ((size_t) -1)
+
+/*
+ * Accounts for the large allocations of a process against one limit. Every
+ * sizeable structure (transposition table, search arenas, ...) reserves its
+ * memory here before allocating it, under the name of its component, and
+ * releases it when freed. Caches ask for what they would like and take
+ * whatever is granted, so a tight budget shrinks them instead of running the
+ * process out of memory; memory the engine cannot work without is charged
+ * even past the limit, where it at least shows up in the usage. Safe to use
+ * from any thread.
+ */
+class MemoryBudget {
+
+public:
+    MemoryBudget(size_t limit);
+
+    size_t reserve(const std::string &component, size_t wanted, size_t minimum);
+    void charge(const std::string &component, size_t bytes);
+    void release(const std::string &component, size_t bytes);
+
+    void setLimit(size_t limit);
+    size_t getLimit();
+    size_t getUsed();
+    size_t getAvailable();
+    std::map<std::string, size_t> getUsage();
+
+    static MemoryBudget &process();
+
+private:
+    std::mutex lock;
+    size_t limit;
+    size_t used;
+    std::map<std::string, size_t> components;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "nboard.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+NBoardSession::NBoardSession(istream &in, ostream &out) : in(in), out(out) {
+    table = new TranspositionTable((size_t) NBOARD_TT_MB << 20);
+    endgameTable = new EndgameTable(ENDGAME_TT_BYTES);
+    toMove = BLACK;
+}
+
+NBoardSession::~NBoardSession() {
+    delete table;
+    delete endgameTable;
+}
+
+/*
+ * Handles commands until the input ends. Returns the exit status.
+ */
+int NBoardSession::run() {
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        stringstream words(line);
+        string command;
+        words >> command;
+
+        if (command == "nboard") {
+            out << "set myname qwerty" << endl;
+        } else if (command == "ping") {
+            string n;
+            words >> n;
+            out << "pong " << n << endl;
+        } else if (command == "set") {
+            string what;
+            words >> what;
+            if (what == "depth") {
+                int depth = 0;
+                words >> depth;
+                if (depth >= 1) config.depth = depth;
+            } else if (what == "game") {
+                string ggf;
+                getline(words, ggf);
+                if (!setGame(ggf)) out << "status bad game" << endl;
+            }
+        } else if (command == "move") {
+            string move;
+            words >> move;
+            if (!playMove(move)) out << "status illegal move " << move << endl;
+        } else if (command == "hint") {
+            int count = 1;
+            words >> count;
+            hint(max(count, 1));
+        } else if (command == "go") {
+            go();
+        }
+    }
+    return 0;
+}
+
+/*
+ * Replaces the game with one in GGF: the starting position from the BO tag,
+ * then the B and W moves in order. Other tags are skipped.
+ */
+bool NBoardSession::setGame(const string &ggf) {
+    Board game;
+    Side turn = BLACK;
+    bool haveBoard = false;
+    size_t i = 0;
+    while (i < ggf.size()) {
+        // Tags are upper case names followed by a bracketed value.
+        if (!isupper(ggf[i])) {
+            i++;
+            continue;
+        }
+        size_t open = ggf.find('[', i);
+        if (open == string::npos) break;
+        size_t close = ggf.find(']', open);
+        if (close == string::npos) return false;
+        string tag = ggf.substr(i, open - i);
+        string value = ggf.substr(open + 1, close - open - 1);
+        i = close + 1;
+
+        if (tag == "BO") {
+            // The board size, then the squares row by row with '*' for
+            // black, 'O' for white and '-' for empty, then the side to move
+            stringstream fields(value);
+            int size = 0;
+            fields >> size;
+            if (size != BOARD_SIZE) return false;
+            string text;
+            getline(fields, text);
+            for (size_t k = 0; k < text.size(); k++) {
+                if (text[k] == '*') text[k] = 'X';
+            }
+            if (!parsePosition(text, &game, &turn)) return false;
+            haveBoard = true;
+        } else if (tag == "B" || tag == "W") {
+            if (!haveBoard) return false;
+            Side mover = (tag == "B") ? BLACK : WHITE;
+            string move = value.substr(0, value.find('/'));
+            if (move.size() >= 2 && toupper(move[0]) == 'P' && toupper(move[1]) == 'A') {
+                if (game.hasMoves(mover)) return false;
+                turn = (mover == BLACK) ? WHITE : BLACK;
+                continue;
+            }
+            Move m(-1, -1);
+            if (!parseMove(move, &m) || !game.checkMove(&m, mover)) return false;
+            game.doMove(&m, mover);
+            turn = (mover == BLACK) ? WHITE : BLACK;
+        }
+    }
+    if (!haveBoard) return false;
+    board = game;
+    toMove = turn;
+    return true;
+}
+
+/*
+ * Plays a move, optionally followed by "/score/time", for the side to move.
+ */
+bool NBoardSession::playMove(const string &text) {
+    string move = text.substr(0, text.find('/'));
+    Side other = (toMove == BLACK) ? WHITE : BLACK;
+    if (move.size() >= 2 && toupper(move[0]) == 'P' && toupper(move[1]) == 'A') {
+        if (board.hasMoves(toMove)) return false;
+        toMove = other;
+        return true;
+    }
+    Move m(-1, -1);
+    if (!parseMove(move, &m) || !board.checkMove(&m, toMove)) return false;
+    board.doMove(&m, toMove);
+    toMove = other;
+    return true;
+}
+
+Player *NBoardSession::newPlayer() {
+    Player *player = new Player(toMove);
+    player->testingMinimax = config.discEval;
+    player->setSearchDepth(config.depth);
+    player->setEndgameEmpties(config.endgameEmpties);
+    player->setInternalDeepening(config.iidDepth, config.iidReduction);
+    player->setEvaluators(config.leafEval, config.orderEval);
+    player->setTranspositionTable(table);
+    player->setEndgameTable(endgameTable);
+    player->setBoard(board.copy());
+    return player;
+}
+
+/*
+ * Reads a square name such as "d3", or "j10" on a larger board, into move.
+ * Returns false unless it names a square on the board.
+ */
+bool NBoardSession::parseMove(const string &name, Move *move) {
+    if (name.size() < 2 || name.size() > 3) return false;
+    if (!isdigit(name[1]) || (name.size() == 3 && !isdigit(name[2]))) return false;
+    int x = tolower(name[0]) - 'a';
+    int y = atoi(name.c_str() + 1) - 1;
+    if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) return false;
+    move->setX(x);
+    move->setY(y);
+    return true;
+}
+
+string NBoardSession::moveName(int square) {
+    if (square < 0) return "PA";
+    return string(1, (char) ('A' + square % BOARD_SIZE)) + to_string(square / BOARD_SIZE + 1);
+}
+
+/*
+ * Scores the best count moves at every depth up to the configured one, and
+ * then exactly if the position is within solving range, writing each round
+ * of results as soon as it is known.
+ */
+void NBoardSession::hint(int count) {
+    Player *player = newPlayer();
+    int empties = BOARD_SQUARES - board.countBlack() - board.countWhite();
+    bool solve = empties <= config.endgameEmpties;
+    out << "status searching" << endl;
+    if (!board.hasMoves(toMove)) {
+        out << "search PA 0 0 0" << endl;
+    }
+    unsigned long long nodes = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int depth = 1; depth <= config.depth + 1 && board.hasMoves(toMove); depth++) {
+        bool exact = (depth > config.depth);
+        if (exact && !solve) break;
+        vector<MoveScore> scores = player->scoreMoves(depth, exact);
+        nodes += player->getLastNodes();
+        for (size_t i = 0; i < scores.size() && (int) i < count; i++) {
+            out << "search " << moveName(scores[i].square) << " " << scores[i].score << " 0 "
+                << (scores[i].proven ? string("100%") : to_string(depth)) << endl;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    out << "nodestats " << nodes << " " << fixed << setprecision(3) << seconds << endl;
+    out << "status" << endl;
+    delete player;
+}
+
+/*
+ * Picks the move to play the way a game would, with no clock.
+ */
+void NBoardSession::go() {
+    Player *player = newPlayer();
+    out << "status thinking" << endl;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Move *move = player->doMove(nullptr, -1);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    int square = (move == nullptr) ? -1 : move->getX() + BOARD_SIZE * move->getY();
+    out << "nodestats " << player->getLastNodes() << " " << fixed << setprecision(3)
+        << seconds << endl;
+    out << "=== " << moveName(square) << "/" << player->getLastScore() << "/" << seconds << endl;
+    out << "status" << endl;
+    delete player;
+    delete move;
+}
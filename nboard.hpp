@@ -0,0 +1,60 @@
+#ifndef __NBOARD_H__
+#define __NBOARD_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common.hpp"
+#include "board.hpp"
+#include "game.hpp"
+#include "tt.hpp"
+using namespace std;
+
+// Size of the transposition table kept between NBoard requests
+#define NBOARD_TT_MB (64)
+
+/*
+ * Speaks the NBoard engine protocol, the one analysis GUIs such as NBoard use
+ * to drive an engine over stdin and stdout:
+ *
+ *   nboard <version>     set myname qwerty
+ *   set depth <n>        search depth for go and hint
+ *   set game <GGF>       replaces the game, e.g. (;GM[Othello]BO[8 ... *]B[f5];)
+ *   move <move>[/...]    plays a move (PA for a pass) in the current game
+ *   hint <n>             "search <move> <score> 0 <depth>" for the n best moves,
+ *                        repeated after every iteration of the deepening
+ *   go                   "=== <move>/<score>/<seconds>" for the move to play
+ *   ping <n>             pong <n>, once everything asked before it is done
+ *
+ * Scores are for the side to move: the evaluation's units while searching,
+ * disc difference once solved or proven to be forced ("100%" depth).
+ * Anything else is ignored, as the protocol asks.
+ */
+class NBoardSession {
+
+public:
+    NBoardSession(istream &in, ostream &out);
+    ~NBoardSession();
+
+    int run();
+
+private:
+    istream &in;
+    ostream &out;
+    EngineConfig config;
+    TranspositionTable *table;
+    EndgameTable *endgameTable;
+
+    Board board;
+    Side toMove;
+
+    bool setGame(const string &ggf);
+    bool playMove(const string &text);
+    void hint(int count);
+    void go();
+    Player *newPlayer();
+    bool parseMove(const string &name, Move *move);
+    string moveName(int square);
+};
+
+#endif
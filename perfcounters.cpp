@@ -0,0 +1,95 @@
+#include "perfcounters.hpp"
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        fds[i] = -1;
+    }
+    tick = 0;
+    reset();
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+/*
+ * Opens the counter group for the calling thread, or keeps it if this thread
+ * already owns it. Counters only measure the thread that opened them, so a
+ * Player moved to another thread (as the match runner does) gets a new group.
+ * Returns false if the counters are not available.
+ */
+bool PerfCounters::open() {
+    if (isOpen() && owner == std::this_thread::get_id()) return true;
+    close();
+#ifdef __linux__
+    static const uint64_t configs[EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+    };
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = (i == 0);
+        fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+        if (fds[i] < 0) {
+            close();
+            return false;
+        }
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    owner = std::this_thread::get_id();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PerfCounters::close() {
+    for (int i = EVENT_COUNT - 1; i >= 0; i--) {
+        if (fds[i] >= 0) ::close(fds[i]);
+        fds[i] = -1;
+    }
+}
+
+/*
+ * Clears the per-phase totals, e.g. at the start of a move.
+ */
+void PerfCounters::reset() {
+    memset(totals, 0, sizeof(totals));
+}
+
+/*
+ * Reads the current value of every counter in the group.
+ */
+bool PerfCounters::read(uint64_t values[EVENT_COUNT]) {
+    // PERF_FORMAT_GROUP layout: the number of events, then each value
+    uint64_t data[1 + EVENT_COUNT];
+    if (::read(fds[0], data, sizeof(data)) != (ssize_t) sizeof(data)) return false;
+    memcpy(values, data + 1, sizeof(uint64_t) * EVENT_COUNT);
+    return true;
+}
+
+/*
+ * Adds the events since before to a phase, scaled by the sampling interval.
+ */
+void PerfCounters::add(PerfPhase phase, const uint64_t before[EVENT_COUNT]) {
+    uint64_t after[EVENT_COUNT];
+    if (!read(after)) return;
+    totals[phase].samples++;
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        totals[phase].events[i] += (after[i] - before[i]) * PERF_SAMPLE_INTERVAL;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef __PERFCOUNTERS_H__
+#define __PERFCOUNTERS_H__
+
+#include <cstdint>
+#include <thread>
+
+// Parts of the search that hardware counters are collected for
+enum PerfPhase {
+    PHASE_MOVEGEN, PHASE_EVAL, PHASE_TT, PHASE_COUNT
+};
+
+// Events read from the counter group, in group order
+enum PerfEvent {
+    EVENT_CYCLES, EVENT_INSTRUCTIONS, EVENT_BRANCH_MISSES, EVENT_CACHE_MISSES, EVENT_COUNT
+};
+
+// Only one scope in this many is measured; reading the counters costs a
+// system call, which is far more than a single checkMove
+#define PERF_SAMPLE_INTERVAL (64)
+
+/*
+ * Counter totals for one phase. samples is the number of scopes actually
+ * measured; the event counts are scaled up to estimate all scopes.
+ */
+struct PerfTotals {
+    uint64_t samples;
+    uint64_t events[EVENT_COUNT];
+};
+
+/*
+ * A group of hardware counters for the calling thread, read with
+ * perf_event_open. Counting is user space only so that it works at the
+ * default perf_event_paranoid level. If the counters cannot be opened (not
+ * Linux, no permission, no PMU in a VM) everything is a no-op.
+ */
+class PerfCounters {
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool open();
+    void close();
+    bool isOpen() { return fds[0] >= 0; }
+    void reset();
+    bool read(uint64_t values[EVENT_COUNT]);
+
+    void add(PerfPhase phase, const uint64_t before[EVENT_COUNT]);
+    const PerfTotals &total(PerfPhase phase) { return totals[phase]; }
+
+    // Counts scope entries so that only every PERF_SAMPLE_INTERVAL'th one
+    // is measured
+    unsigned int tick;
+
+private:
+    int fds[EVENT_COUNT];
+    std::thread::id owner;
+    PerfTotals totals[PHASE_COUNT];
+};
+
+/*
+ * Adds the counter deltas over its lifetime to a phase, for a sample of the
+ * scopes it is placed in. A null or closed PerfCounters costs one branch.
+ */
+class ScopedCounter {
+
+public:
+    ScopedCounter(PerfCounters *counters, PerfPhase phase) {
+        this->counters = nullptr;
+        if (counters != nullptr && counters->isOpen()
+                && ++counters->tick % PERF_SAMPLE_INTERVAL == 0
+                && counters->read(before)) {
+            this->counters = counters;
+            this->phase = phase;
+        }
+    }
+    ~ScopedCounter() {
+        if (counters != nullptr) counters->add(phase, before);
+    }
+
+private:
+    PerfCounters *counters;
+    PerfPhase phase;
+    uint64_t before[EVENT_COUNT];
+};
+
+#endif
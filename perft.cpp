@@ -0,0 +1,344 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Counts the leaves of the game tree to a fixed depth. A pass is a ply of its
+ * own, and a finished game counts as a single leaf wherever it ends. These
+ * are the rules the published counts below follow, so perft from the start
+ * position doubles as a correctness check of the move generator.
+ *
+ * -s 10 counts on the 10x10 board instead, from its start position, with the
+ * two-word bitboards.
+ */
+
+static const unsigned long long KNOWN_COUNTS[] = {
+    1ULL, 4ULL, 12ULL, 56ULL, 244ULL, 1396ULL, 8200ULL, 55092ULL, 390216ULL,
+    3005288ULL, 24571284ULL, 212258800ULL, 1939886636ULL, 18429641748ULL,
+    184042084512ULL
+};
+static const int KNOWN_DEPTH = sizeof(KNOWN_COUNTS) / sizeof(KNOWN_COUNTS[0]) - 1;
+
+// The same from the 10x10 start position
+static const unsigned long long KNOWN_COUNTS_10[] = {
+    1ULL, 4ULL, 12ULL, 56ULL, 244ULL, 1396ULL, 8200ULL, 55180ULL, 392268ULL, 3045812ULL
+};
+static const int KNOWN_DEPTH_10 = sizeof(KNOWN_COUNTS_10) / sizeof(KNOWN_COUNTS_10[0]) - 1;
+
+/*
+ * One cached subtree count. The full position is kept rather than a hash
+ * signature so that a cache collision can never give a wrong count.
+ */
+template <typename B>
+struct PerftEntry {
+    typename B::Bits black, white;
+    uint64_t count;
+    int32_t depth;
+    int32_t side;
+};
+
+/*
+ * Shared table of subtree counts, always-replace, guarded by striped locks.
+ */
+template <typename B>
+class PerftCache {
+
+public:
+    PerftCache(size_t megabytes);
+
+    bool probe(B &board, Side side, int depth, unsigned long long *count);
+    void store(B &board, Side side, int depth, unsigned long long count);
+    bool enabled() { return !table.empty(); }
+
+private:
+    static const int LOCKS = 256;
+    vector<PerftEntry<B> > table;
+    size_t mask;
+    mutex locks[LOCKS];
+
+    size_t index(typename B::Bits black, typename B::Bits white, Side side, int depth);
+};
+
+static uint64_t fold(uint64_t bits) {
+    return bits;
+}
+
+static uint64_t fold(uint128_t bits) {
+    return (uint64_t) bits ^ ((uint64_t) (bits >> 64) * 0xD6E8FEB86659FD93ULL);
+}
+
+template <typename B>
+PerftCache<B>::PerftCache(size_t megabytes) {
+    size_t entries = 0;
+    if (megabytes > 0) {
+        entries = 1;
+        while (entries * 2 * sizeof(PerftEntry<B>) <= megabytes << 20) entries *= 2;
+    }
+    PerftEntry<B> empty = { 0, 0, 0, -1, 0 };
+    table.assign(entries, empty);
+    mask = entries - 1;
+}
+
+template <typename B>
+size_t PerftCache<B>::index(typename B::Bits black, typename B::Bits white, Side side,
+        int depth) {
+    uint64_t h = fold(black) * 0x9E3779B97F4A7C15ULL;
+    h ^= (fold(white) + side + ((uint64_t) depth << 1)) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return h & mask;
+}
+
+template <typename B>
+bool PerftCache<B>::probe(B &board, Side side, int depth, unsigned long long *count) {
+    typename B::Bits black = board.getBits(BLACK);
+    typename B::Bits white = board.getBits(WHITE);
+    size_t i = index(black, white, side, depth);
+    lock_guard<mutex> guard(locks[i % LOCKS]);
+    PerftEntry<B> &e = table[i];
+    if (e.black != black || e.white != white || e.side != side || e.depth != depth) {
+        return false;
+    }
+    *count = e.count;
+    return true;
+}
+
+template <typename B>
+void PerftCache<B>::store(B &board, Side side, int depth, unsigned long long count) {
+    typename B::Bits black = board.getBits(BLACK);
+    typename B::Bits white = board.getBits(WHITE);
+    size_t i = index(black, white, side, depth);
+    lock_guard<mutex> guard(locks[i % LOCKS]);
+    PerftEntry<B> e = { black, white, count, depth, side };
+    table[i] = e;
+}
+
+/*
+ * A subtree still to be counted, produced by splitting the top of the tree.
+ */
+template <typename B>
+struct PerftTask {
+    B board;
+    Side side;
+    int depth;
+    bool passed;
+};
+
+static bool bulk = false;
+
+template <typename B>
+static unsigned long long perft(PerftCache<B> *cache, B &board, Side side, int depth,
+        bool passed) {
+    if (depth == 0) return 1;
+
+    Side other = (side == BLACK) ? WHITE : BLACK;
+    unsigned long long count = 0;
+    if (cache->enabled() && depth >= 2 && cache->probe(board, side, depth, &count)) {
+        return count;
+    }
+
+    typename B::Bits legal = board.legalMoves(side);
+    if (bulk && depth == 1) {
+        count = countSquares(legal);
+    } else {
+        for (typename B::Bits left = legal; left != 0; left &= left - 1) {
+            int square = lowestSquare(left);
+            Move move(square % B::SIZE, square / B::SIZE);
+            B child = board;
+            child.doMove(&move, side);
+            count += perft(cache, child, other, depth - 1, false);
+        }
+    }
+
+    if (legal == 0) {
+        // Two passes in a row end the game; the finished game is one leaf.
+        count = passed ? 1 : perft(cache, board, other, depth - 1, true);
+    }
+
+    if (cache->enabled() && depth >= 2) cache->store(board, side, depth, count);
+    return count;
+}
+
+/*
+ * Expands the top of the tree one ply at a time until there are enough
+ * subtrees to keep every thread busy. Leaves met on the way are added to
+ * count directly.
+ */
+template <typename B>
+static vector<PerftTask<B> > split(B &board, Side side, int depth, size_t wanted,
+        unsigned long long *count) {
+    PerftTask<B> root = { board, side, depth, false };
+    vector<PerftTask<B> > tasks(1, root);
+    while (tasks.size() < wanted) {
+        vector<PerftTask<B> > next;
+        bool expanded = false;
+        for (size_t t = 0; t < tasks.size(); t++) {
+            PerftTask<B> &task = tasks[t];
+            if (task.depth <= 2) {
+                next.push_back(task);
+                continue;
+            }
+            expanded = true;
+            Side other = (task.side == BLACK) ? WHITE : BLACK;
+            BasicMoveList<B::SIZE> moves = task.board.getMoves(task.side);
+            for (int k = 0; k < moves.count; k++) {
+                Move move(moves.squares[k] % B::SIZE, moves.squares[k] / B::SIZE);
+                PerftTask<B> child = { task.board, other, task.depth - 1, false };
+                child.board.doMove(&move, task.side);
+                next.push_back(child);
+            }
+            if (moves.count == 0) {
+                if (task.passed) {
+                    (*count)++;
+                } else {
+                    PerftTask<B> child = { task.board, other, task.depth - 1, true };
+                    next.push_back(child);
+                }
+            }
+        }
+        tasks.swap(next);
+        if (!expanded) break;
+    }
+    return tasks;
+}
+
+/*
+ * Counts the leaves below a position with the given number of threads.
+ */
+template <typename B>
+static unsigned long long countLeaves(PerftCache<B> *cache, B &board, Side side, int depth,
+        int threads) {
+    unsigned long long total = 0;
+    vector<PerftTask<B> > tasks = split(board, side, depth, threads * 16, &total);
+
+    atomic<size_t> next(0);
+    atomic<unsigned long long> sum(0);
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread([&]() {
+            size_t t;
+            while ((t = next++) < tasks.size()) {
+                sum += perft(cache, tasks[t].board, tasks[t].side, tasks[t].depth,
+                    tasks[t].passed);
+            }
+        }));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+    return total + sum;
+}
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-j threads] [-b] [-c cacheMB] [-s 8|10] [-f positions] depth"
+         << endl;
+    cerr << "  -b  count the last ply from the legal moves instead of playing them" << endl;
+    cerr << "  -s  board size; only the start position can be counted on 10x10" << endl;
+    cerr << "  -f  file of positions, one per line (64 squares of X/O/- then X or O to move)" << endl;
+    exit(-1);
+}
+
+/*
+ * Counts the 10x10 start position.
+ */
+static bool countLargeBoard(int depth, int threads, size_t cacheMB) {
+    PerftCache<BasicBoard<10> > cache(cacheMB);
+    BasicBoard<10> board;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    unsigned long long leaves = countLeaves(&cache, board, BLACK, depth, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "10x10 start depth " << depth << ": " << leaves << " leaves in " << seconds << " s ("
+         << (long long) (leaves / max(seconds, 1e-9)) << " leaves/s)";
+    bool match = true;
+    if (depth <= KNOWN_DEPTH_10) {
+        match = (leaves == KNOWN_COUNTS_10[depth]);
+        cout << (match ? " ok" : " MISMATCH, expected ");
+        if (!match) cout << KNOWN_COUNTS_10[depth];
+    }
+    cout << endl;
+    return match;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = thread::hardware_concurrency();
+    size_t cacheMB = 0;
+    const char *positionFile = nullptr;
+    int size = BOARD_SIZE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:bc:s:f:")) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'b': bulk = true; break;
+            case 'c': cacheMB = strtoul(optarg, nullptr, 10); break;
+            case 's': size = atoi(optarg); break;
+            case 'f': positionFile = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) usage(argv[0]);
+    int depth = atoi(argv[optind]);
+    if (depth < 0) usage(argv[0]);
+    if (threads < 1) threads = 1;
+    if (size != BOARD_SIZE && (size != 10 || positionFile != nullptr)) usage(argv[0]);
+    if (size == 10) return countLargeBoard(depth, threads, cacheMB) ? 0 : 1;
+
+    vector<string> positions;
+    if (positionFile == nullptr) {
+        Board start;
+        positions.push_back(formatPosition(&start, BLACK));
+    } else {
+        ifstream in(positionFile);
+        if (!in) {
+            cerr << "perft: cannot read " << positionFile << endl;
+            exit(-1);
+        }
+        string line;
+        while (getline(in, line)) {
+            if (!line.empty() && line[0] != '#') positions.push_back(line);
+        }
+    }
+
+    PerftCache<Board> cache(cacheMB);
+    bool allMatch = true;
+    unsigned long long totalLeaves = 0;
+    double totalSeconds = 0.0;
+    for (size_t p = 0; p < positions.size(); p++) {
+        Board board;
+        Side side;
+        if (!parsePosition(positions[p], &board, &side)) {
+            cerr << "perft: bad position: " << positions[p] << endl;
+            exit(-1);
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        unsigned long long leaves = countLeaves(&cache, board, side, depth, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        totalLeaves += leaves;
+        totalSeconds += seconds;
+
+        cout << formatPosition(&board, side) << " depth " << depth << ": "
+             << leaves << " leaves in " << seconds << " s ("
+             << (long long) (leaves / max(seconds, 1e-9)) << " leaves/s)";
+        if (positionFile == nullptr && depth <= KNOWN_DEPTH) {
+            bool match = (leaves == KNOWN_COUNTS[depth]);
+            allMatch = allMatch && match;
+            cout << (match ? " ok" : " MISMATCH, expected ");
+            if (!match) cout << KNOWN_COUNTS[depth];
+        }
+        cout << endl;
+    }
+
+    if (positions.size() > 1) {
+        cout << "total: " << totalLeaves << " leaves in " << totalSeconds << " s ("
+             << (long long) (totalLeaves / max(totalSeconds, 1e-9)) << " leaves/s)" << endl;
+    }
+    return allMatch ? 0 : 1;
+}
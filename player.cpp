@@ -1,5 +1,6 @@
 #include "player.hpp"
 #include <limits.h>
+#include <algorithm>
 
 /*
  * Constructor for the player; initialize everything here. The side your AI is
@@ -12,6 +13,46 @@ Player::Player(Side side) {
 
     this->board = new Board();
     this->side = side;
+
+    this->maxDepth = DEFAULT_SEARCH_DEPTH;
+    this->endgameEmpties = DEFAULT_ENDGAME_EMPTIES;
+    this->iidDepth = DEFAULT_IID_DEPTH;
+    this->iidReduction = DEFAULT_IID_REDUCTION;
+    this->setEvaluators(DEFAULT_LEAF_EVAL, DEFAULT_ORDER_EVAL);
+    this->telemetry = nullptr;
+    this->perf = nullptr;
+    this->traceWriter = nullptr;
+    this->replaying = nullptr;
+    this->tt = nullptr;
+    this->endgameTable = nullptr;
+    //the vectors in a search's results are reserved once, here, for the most
+    //a search can put in them: a principal variation of every ply, a
+    //checkpoint per iteration, and an abort each for the solve it may try
+    //first and for iterative deepening. Each search clears and refills them
+    this->last = SearchStats();
+    this->last.pv.reserve(MAX_SEARCH_PLY);
+    this->trace.checkpoints.reserve(MAX_SEARCH_PLY + 1);
+    this->trace.aborts.reserve(2);
+    this->nodes = 0;
+    this->cutoffs = 0;
+    this->firstMoveCutoffs = 0;
+    this->ttProbes = 0;
+    this->ttHits = 0;
+    this->ttCutoffs = 0;
+    this->iidSearches = 0;
+    this->endgameProbes = 0;
+    this->endgameHits = 0;
+    this->endgameCutoffs = 0;
+    this->timed = false;
+    this->abortable = false;
+    this->aborted = false;
+    this->ply = 0;
+
+    //everything the search needs per ply is carved out of the arena once,
+    //here; each search releases whatever else was allocated after it
+    this->arena = new Arena(SEARCH_ARENA_BYTES);
+    this->scratch = this->arena->create<PlyScratch>(MAX_SEARCH_PLY + 1);
+    this->searchMark = this->arena->mark();
 }
 
 /*
@@ -20,6 +61,49 @@ Player::Player(Side side) {
  */
 Player::~Player() {
     delete this->board;
+    delete this->perf;
+    delete this->arena;
+}
+
+/*
+ * Replaces the board the player is tracking. The player takes ownership of
+ * the new board.
+ */
+void Player::setBoard(Board *aBoard) {
+    if (aBoard != this->board) {
+        delete this->board;
+    }
+    this->board = aBoard;
+}
+
+/*
+ * Sets when internal iterative deepening is used: at nodes with at least depth
+ * plies left, searching reduction plies shallower. A depth of 0 turns it off;
+ * the reduction is at least one ply.
+ */
+void Player::setInternalDeepening(int depth, int reduction) {
+    this->iidDepth = depth;
+    this->iidReduction = std::max(reduction, 1);
+}
+
+/*
+ * Sets the evaluator used at the leaves and the one used to order moves, which
+ * may be EVAL_NONE. With no leaf evaluator the default one is used.
+ */
+void Player::setEvaluators(EvalKind leaf, EvalKind order) {
+    this->leafEval = leaf == EVAL_NONE ? DEFAULT_LEAF_EVAL : leaf;
+    this->orderEval = order;
+    this->leafEvaluator = getEvaluator(this->leafEval);
+    this->orderEvaluator = getEvaluator(this->orderEval);
+}
+
+/*
+ * Turns hardware counter collection on or off. The counters are opened on the
+ * thread that calls doMove; if they are unavailable the statistics say so.
+ */
+void Player::setPerfCounters(bool enabled) {
+    delete this->perf;
+    this->perf = enabled ? new PerfCounters() : nullptr;
 }
 
 /*
@@ -39,19 +123,548 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
     if (opponentsMove != nullptr) {
         this->board->doMove(opponentsMove, this->side == BLACK ? WHITE : BLACK);
     }
-    
-    //need minimum plus one because -INT_MIN overflows and becomes negative again
-    std::pair<int, Move*> results = this->negamax(this->board, this->side, 7, INT_MIN + 1, INT_MAX);
-    
-    Move *nextMove = results.second;
-    
+
+    Move *nextMove = this->search(msLeft);
+    if (this->traceWriter != nullptr) {
+        this->traceWriter->write(this->trace);
+    }
+
     if (nextMove != nullptr) {
         this->board->doMove(nextMove, this->side);
     }
-    
+
     return nextMove;
 }
 
+/*
+ * Reruns a traced search on the position it started from. The clock is not
+ * consulted; instead each search is stopped at the node count where the clock
+ * stopped it originally, so the replay visits exactly the same nodes. The
+ * replay's own trace is available from getLastTrace() for comparison. The
+ * move is not played on the board.
+ */
+Move *Player::replay(const TraceMove &recorded) {
+    Board *replayBoard = new Board();
+    replayBoard->setBits(recorded.black, recorded.white);
+    this->setBoard(replayBoard);
+    this->side = (Side) recorded.side;
+    this->maxDepth = recorded.maxDepth;
+    this->endgameEmpties = recorded.endgameEmpties;
+    this->iidDepth = recorded.iidDepth;
+    this->iidReduction = recorded.iidReduction;
+    this->testingMinimax = recorded.discEval != 0;
+    this->setEvaluators((EvalKind) recorded.leafEval, (EvalKind) recorded.orderEval);
+
+    this->replaying = &recorded;
+    Move *nextMove = this->search(recorded.msLeft);
+    this->replaying = nullptr;
+    return nextMove;
+}
+
+/*
+ * Searches the current board for the player's next move without playing it.
+ */
+Move *Player::search(int msLeft) {
+    //spread the remaining time over the moves we still expect to make; a
+    //non-positive msLeft means the caller is not keeping time
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int empties = BOARD_SQUARES - this->board->countBlack() - this->board->countWhite();
+    int budgetMs = 0;
+    this->timed = msLeft > 0;
+    if (this->timed) {
+        budgetMs = msLeft / ((empties + 1) / 2 + 1);
+        this->deadline = start + std::chrono::milliseconds(budgetMs);
+    }
+
+    int bestSquare = -1;
+    this->arena->release(this->searchMark);
+    this->nodes = 0;
+    this->cutoffs = 0;
+    this->firstMoveCutoffs = 0;
+    this->ttProbes = 0;
+    this->ttHits = 0;
+    this->ttCutoffs = 0;
+    this->iidSearches = 0;
+    this->endgameProbes = 0;
+    this->endgameHits = 0;
+    this->endgameCutoffs = 0;
+    this->aborted = false;
+    this->abortable = true;
+    this->ply = 0;
+    this->resetStats();
+    this->last.msLeft = msLeft;
+    this->last.budgetMs = budgetMs;
+    this->resetTrace();
+    this->trace.black = this->board->getBits(BLACK);
+    this->trace.white = this->board->getBits(WHITE);
+    this->trace.side = this->side;
+    this->trace.msLeft = msLeft;
+    this->trace.maxDepth = this->maxDepth;
+    this->trace.endgameEmpties = this->endgameEmpties;
+    this->trace.iidDepth = this->iidDepth;
+    this->trace.iidReduction = this->iidReduction;
+    this->trace.discEval = this->testingMinimax;
+    this->trace.leafEval = this->leafEval;
+    this->trace.orderEval = this->orderEval;
+    this->trace.ttEntries = this->tt != nullptr ? this->tt->size() : 0;
+    this->trace.endgameEntries = this->endgameTable != nullptr ? this->endgameTable->size() : 0;
+    if (this->perf != nullptr) {
+        this->perf->open();
+        this->perf->reset();
+    }
+
+    //a move that is the only one, or a pass, needs no search to choose it;
+    //its score is still wanted by whoever reads the result, so it gets a
+    //short search, or an exact one near the end, which is never cut short
+    Board::Bits legal = this->legalMoves(this->board, this->side);
+    if (countSquares(legal) <= 1) {
+        bestSquare = legal != 0 ? lowestSquare(legal) : -1;
+        this->last.stop = "forced";
+        this->abortable = false;
+        if (empties <= this->endgameEmpties && !this->testingMinimax) {
+            this->last.score = this->endgameScore(this->board, this->side, -BOARD_SQUARES,
+                BOARD_SQUARES, false);
+            this->last.depth = empties;
+            this->last.solved = true;
+        } else {
+            int depth = std::min(FORCED_SCORE_DEPTH, this->maxDepth);
+            this->last.score = this->negamaxScore(this->board, this->side, depth,
+                INT_MIN + 1, INT_MAX);
+            this->last.depth = depth;
+        }
+        this->last.pv.assign(this->pvTable[0], this->pvTable[0] + this->pvLength[0]);
+        this->checkpoint(bestSquare);
+    }
+
+    //close to the end, play perfectly if the solve finishes in time; the
+    //heuristic search below is the fallback. The solve only gets part of the
+    //time, so that the fallback still has enough to search properly
+    if (this->last.stop == nullptr && empties <= this->endgameEmpties && !this->testingMinimax) {
+        if (this->timed) {
+            this->deadline = start + std::chrono::milliseconds(budgetMs / ENDGAME_SOLVE_SHARE);
+        }
+        int score = this->endgameScore(this->board, this->side, -BOARD_SQUARES, BOARD_SQUARES,
+            false);
+        if (!this->aborted) {
+            bestSquare = this->scratch[0].best;
+            this->last.score = score;
+            this->last.depth = empties;
+            this->last.solved = true;
+            this->last.stop = "solved";
+            this->last.pv.assign(this->pvTable[0], this->pvTable[0] + this->pvLength[0]);
+            this->checkpoint(bestSquare);
+        } else {
+            this->aborted = false;
+        }
+        if (this->timed) {
+            this->deadline = start + std::chrono::milliseconds(budgetMs);
+        }
+    }
+
+    //iterative deepening - an iteration that runs out of time is thrown away
+    //and the move from the last completed depth is played; depth 1 is never
+    //cut short so that there is always a move
+    std::chrono::steady_clock::time_point deepeningStart = std::chrono::steady_clock::now();
+    int stableIterations = 0;
+    for (int depth = 1; depth <= this->maxDepth && this->last.stop == nullptr; depth++) {
+        //a replay starts exactly as many iterations as the original search
+        if (this->replaying != nullptr && this->trace.iterations >= this->replaying->iterations) break;
+        this->trace.iterations++;
+        this->abortable = depth > 1;
+        //need minimum plus one because -INT_MIN overflows and becomes negative again
+        int score = this->negamaxScore(this->board, this->side, depth, INT_MIN + 1, INT_MAX);
+        if (this->aborted) {
+            this->last.stop = "time";
+            break;
+        }
+        stableIterations = this->scratch[0].best == bestSquare ? stableIterations + 1 : 1;
+        bestSquare = this->scratch[0].best;
+        this->last.score = score;
+        this->last.depth = depth;
+        this->last.pv.assign(this->pvTable[0], this->pvTable[0] + this->pvLength[0]);
+        this->checkpoint(bestSquare);
+
+        if (bestSquare < 0) break;
+
+        //when the same move keeps coming out on top and nothing else gets
+        //close, deeper iterations are unlikely to change the decision; the
+        //time not spent stays on the clock for the moves after this one.
+        //This only looks at search results, so a replay stops here too
+        if (this->timed && stableIterations >= EARLY_STOP_ITERATIONS
+                && depth > EARLY_STOP_REDUCTION
+                && this->clearlyBest(bestSquare, depth - EARLY_STOP_REDUCTION,
+                    score - EARLY_STOP_MARGIN)) {
+            this->last.stop = "stable";
+            break;
+        }
+        //the check above can run out of time, or the next iteration is
+        //unlikely to finish in time
+        if (this->aborted) {
+            this->last.stop = "time";
+            break;
+        }
+        if (this->timed && this->replaying == nullptr) {
+            std::chrono::steady_clock::duration elapsed =
+                std::chrono::steady_clock::now() - deepeningStart;
+            if (elapsed * 2 > this->deadline - deepeningStart) {
+                this->last.stop = "time";
+                break;
+            }
+        }
+    }
+    if (this->last.stop == nullptr) this->last.stop = "depth";
+    if (this->last.solved) {
+        this->last.proven = true;
+    } else {
+        this->last.score = this->provenScore(this->last.score, &this->last.proven);
+    }
+    this->last.nodes = this->nodes;
+    this->last.cutoffs = this->cutoffs;
+    this->last.firstMoveCutoffs = this->firstMoveCutoffs;
+    this->last.ttProbes = this->ttProbes;
+    this->last.ttHits = this->ttHits;
+    this->last.ttCutoffs = this->ttCutoffs;
+    this->last.iidSearches = this->iidSearches;
+    this->last.endgameProbes = this->endgameProbes;
+    this->last.endgameHits = this->endgameHits;
+    this->last.endgameCutoffs = this->endgameCutoffs;
+    this->last.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    if (this->perf != nullptr && this->perf->isOpen()) {
+        this->last.perfAvailable = true;
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            this->last.perf[phase] = this->perf->total((PerfPhase) phase);
+        }
+    }
+    this->last.arenaPeak = this->arena->getPeak();
+    this->trace.nodes = this->nodes;
+    this->trace.move = bestSquare;
+    if (this->telemetry != nullptr) {
+        this->writeTelemetry();
+    }
+
+    return bestSquare < 0 ? nullptr : new Move(bestSquare % BOARD_SIZE, bestSquare / BOARD_SIZE);
+}
+
+/*
+ * Returns true if every root move other than best scores less than bound when
+ * searched to the given depth. Each of them is searched with a null window
+ * just below bound, which only has to show that the move falls short, not how
+ * far; this gives up as soon as one does not, or the time runs out.
+ */
+bool Player::clearlyBest(int best, int depth, int bound) {
+    Side oppositeSide = this->side == WHITE ? BLACK : WHITE;
+    //the root's move list is left over from the iteration that just finished
+    MoveList &moves = this->scratch[0].moves;
+    for (int k = 0; k < moves.count; k++) {
+        int square = moves.squares[k];
+        if (square == best) continue;
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        Board *childBoard = this->makeMove(this->board, &move, this->side);
+        this->ply = 1;
+        int score = -this->negamaxScore(childBoard, oppositeSide, depth - 1, -bound, -bound + 1);
+        this->ply = 0;
+        if (this->aborted || score >= bound) return false;
+    }
+    return true;
+}
+
+/*
+ * Clears the results of the previous search, keeping the capacity of the
+ * principal variation so that filling it in again allocates nothing.
+ */
+void Player::resetStats() {
+    std::vector<int> pv;
+    pv.swap(this->last.pv);
+    this->last = SearchStats();
+    pv.clear();
+    this->last.pv.swap(pv);
+}
+
+/*
+ * Clears the trace of the previous search the same way.
+ */
+void Player::resetTrace() {
+    std::vector<uint64_t> aborts;
+    std::vector<TraceCheckpoint> checkpoints;
+    aborts.swap(this->trace.aborts);
+    checkpoints.swap(this->trace.checkpoints);
+    this->trace = TraceMove();
+    aborts.clear();
+    checkpoints.clear();
+    this->trace.aborts.swap(aborts);
+    this->trace.checkpoints.swap(checkpoints);
+}
+
+/*
+ * Adds the result of a completed iteration or solve to the trace.
+ */
+void Player::checkpoint(int square) {
+    TraceCheckpoint c;
+    c.depth = this->last.depth;
+    c.score = this->last.score;
+    c.move = square;
+    c.nodes = this->nodes;
+    this->trace.checkpoints.push_back(c);
+}
+
+/*
+ * Returns true once the current search has run past its deadline. Only polls
+ * the clock every few thousand nodes, and records the node count whenever it
+ * stops a search so that a replay can stop at the same point.
+ */
+bool Player::outOfTime() {
+    if (this->aborted) return true;
+    if (!this->timed || !this->abortable || (this->nodes & 4095) != 0) return false;
+    if (this->replaying != nullptr) {
+        size_t next = this->trace.aborts.size();
+        this->aborted = next < this->replaying->aborts.size()
+            && this->replaying->aborts[next] == this->nodes;
+    } else {
+        this->aborted = std::chrono::steady_clock::now() >= this->deadline;
+    }
+    if (this->aborted) {
+        this->trace.aborts.push_back(this->nodes);
+    }
+    return this->aborted;
+}
+
+/*
+ * Records that the move on the given square (-1 for a pass) is the best one
+ * found so far at the current ply, followed by the best line below it.
+ */
+void Player::updatePv(int square) {
+    int *row = this->pvTable[this->ply];
+    int *childRow = this->pvTable[this->ply + 1];
+    row[this->ply] = square;
+    int childLength = std::max(this->pvLength[this->ply + 1], this->ply + 1);
+    for (int k = this->ply + 1; k < childLength; k++) {
+        row[k] = childRow[k];
+    }
+    this->pvLength[this->ply] = childLength;
+}
+
+/*
+ * Writes the statistics of the last search as one JSON line.
+ */
+void Player::writeTelemetry() {
+    const SearchStats &s = this->last;
+    ostream &out = *this->telemetry;
+    long nps = (long) (s.nodes * 1000 / std::max(s.timeMs, 1L));
+    double firstRate = s.cutoffs > 0 ? (double) s.firstMoveCutoffs / s.cutoffs : 0.0;
+    out << "{\"side\":\"" << (this->side == BLACK ? "black" : "white") << "\""
+        << ",\"discs\":" << this->board->countBlack() + this->board->countWhite()
+        << ",\"msLeft\":" << s.msLeft << ",\"budgetMs\":" << s.budgetMs
+        << ",\"timeMs\":" << s.timeMs << ",\"depth\":" << s.depth
+        << ",\"solved\":" << (s.solved ? "true" : "false") << ",\"stop\":\"" << s.stop << "\""
+        << ",\"proven\":" << (s.proven ? "true" : "false") << ",\"score\":" << s.score
+        << ",\"nodes\":" << s.nodes << ",\"nps\":" << nps
+        << ",\"cutoffs\":" << s.cutoffs << ",\"firstMoveCutoffRate\":" << firstRate
+        << ",\"iidSearches\":" << s.iidSearches << ",\"arenaPeak\":" << s.arenaPeak
+        << ",\"pv\":[";
+    for (size_t i = 0; i < s.pv.size(); i++) {
+        if (i > 0) out << ",";
+        if (s.pv[i] < 0) {
+            out << "\"pass\"";
+        } else {
+            out << "\"" << (char) ('a' + s.pv[i] % BOARD_SIZE) << s.pv[i] / BOARD_SIZE + 1 << "\"";
+        }
+    }
+    out << "]";
+    if (this->tt != nullptr) {
+        out << ",\"tt\":{\"probes\":" << s.ttProbes << ",\"hits\":" << s.ttHits
+            << ",\"cutoffs\":" << s.ttCutoffs << "}";
+    }
+    if (this->endgameTable != nullptr) {
+        out << ",\"endgameTable\":{\"probes\":" << s.endgameProbes << ",\"hits\":" << s.endgameHits
+            << ",\"cutoffs\":" << s.endgameCutoffs << "}";
+    }
+    //the whole process's memory, not just this player's
+    MemoryBudget &budget = MemoryBudget::process();
+    std::map<std::string, size_t> usage = budget.getUsage();
+    out << ",\"memory\":{\"limit\":";
+    if (budget.getLimit() == MEMORY_UNLIMITED) {
+        out << "null";
+    } else {
+        out << budget.getLimit();
+    }
+    out << ",\"used\":" << budget.getUsed();
+    for (std::map<std::string, size_t>::iterator it = usage.begin(); it != usage.end(); ++it) {
+        out << ",\"" << it->first << "\":" << it->second;
+    }
+    out << "}";
+    if (this->perf != nullptr) {
+        static const char *phases[PHASE_COUNT] = { "movegen", "eval", "tt" };
+        out << ",\"perf\":";
+        if (!s.perfAvailable) {
+            out << "null";
+        }
+        for (int phase = 0; s.perfAvailable && phase < PHASE_COUNT; phase++) {
+            const PerfTotals &t = s.perf[phase];
+            out << (phase == 0 ? "{" : ",") << "\"" << phases[phase] << "\":{"
+                << "\"samples\":" << t.samples
+                << ",\"cycles\":" << t.events[EVENT_CYCLES]
+                << ",\"instructions\":" << t.events[EVENT_INSTRUCTIONS]
+                << ",\"branchMisses\":" << t.events[EVENT_BRANCH_MISSES]
+                << ",\"cacheMisses\":" << t.events[EVENT_CACHE_MISSES] << "}"
+                << (phase == PHASE_COUNT - 1 ? "}" : "");
+        }
+    }
+    out << "}" << std::endl;
+}
+
+Board::Bits Player::legalMoves(Board *board, Side side) {
+    ScopedCounter counter(this->perf, PHASE_MOVEGEN);
+    return board->legalMoves(side);
+}
+
+void Player::legalMoves(Board *board, Board::Bits *blackMoves, Board::Bits *whiteMoves) {
+    ScopedCounter counter(this->perf, PHASE_MOVEGEN);
+    board->legalMoves(blackMoves, whiteMoves);
+}
+
+/*
+ * Plays the move on a copy of the board in the next ply's scratch space and
+ * returns the copy. It stays valid until a sibling move is made.
+ */
+Board *Player::makeMove(Board *board, Move *move, Side side) {
+    ScopedCounter counter(this->perf, PHASE_MOVEGEN);
+    Board *childBoard = &this->scratch[this->ply + 1].board;
+    *childBoard = *board;
+    childBoard->doMove(move, side);
+    return childBoard;
+}
+
+/*
+ * Fills moves with the squares of a legal-move mask, x + BOARD_SIZE*y, in the order
+ * the search tries them: first if it is legal, then the rest. With depth plies
+ * left, at least ORDER_EVAL_DEPTH, the rest go best first by the ordering
+ * evaluator's score of the position each leads to; otherwise, and between
+ * equal scores, from the lowest square up.
+ */
+void Player::orderMoves(Board *board, Side side, Board::Bits legal, int first, int depth,
+        MoveList *moves) {
+    moves->count = 0;
+    if (first >= 0 && (legal >> first & 1)) {
+        moves->squares[moves->count++] = first;
+        legal &= ~((Board::Bits) 1 << first);
+    }
+    int rest = moves->count;
+    for (; legal != 0; legal &= legal - 1) {
+        moves->squares[moves->count++] = lowestSquare(legal);
+    }
+    if (this->orderEvaluator == nullptr || depth < ORDER_EVAL_DEPTH) return;
+
+    //score every child once, then insertion sort, which keeps equal scores
+    //in square order and is quick for the dozen or so moves of a position
+    int scores[Board::SQUARES];
+    for (int k = rest; k < moves->count; k++) {
+        int square = moves->squares[k];
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        scores[k] = this->orderScore(this->makeMove(board, &move, side), side);
+    }
+    for (int k = rest + 1; k < moves->count; k++) {
+        int square = moves->squares[k];
+        int score = scores[k];
+        int j = k;
+        for (; j > rest && scores[j - 1] < score; j--) {
+            moves->squares[j] = moves->squares[j - 1];
+            scores[j] = scores[j - 1];
+        }
+        moves->squares[j] = square;
+        scores[j] = score;
+    }
+}
+
+/*
+ * The leaf evaluation, or the disc difference when testing minimax.
+ */
+int Player::evaluate(Board *board, Side side) {
+    ScopedCounter counter(this->perf, PHASE_EVAL);
+    if (this->testingMinimax) {
+        return board->getScore(side, true);
+    }
+    return this->leafEvaluator->evaluate(board, side);
+}
+
+/*
+ * The leaf evaluation of a position whose legal moves the search already has.
+ */
+int Player::evaluate(Board *board, Side side, Board::Bits blackMoves, Board::Bits whiteMoves) {
+    ScopedCounter counter(this->perf, PHASE_EVAL);
+    if (this->testingMinimax) {
+        return board->getScore(side, true);
+    }
+    return this->leafEvaluator->evaluateWithMoves(board, side, blackMoves, whiteMoves);
+}
+
+/*
+ * The ordering evaluation, measured along with the leaf one.
+ */
+int Player::orderScore(Board *board, Side side) {
+    ScopedCounter counter(this->perf, PHASE_EVAL);
+    return this->orderEvaluator->evaluate(board, side);
+}
+
+/*
+ * Scores a finished game for the given side by its disc difference, scaled so
+ * that a won game outranks anything the evaluation can say about an
+ * unfinished one and a lost game ranks below it.
+ */
+int Player::finalScore(Board *board, Side side) {
+    Side other = side == WHITE ? BLACK : WHITE;
+    return (board->count(side) - board->count(other)) * FINAL_SCORE_WEIGHT;
+}
+
+/*
+ * Converts a heuristic search score to the units it is reported in. Only a
+ * game end the search reached scores FINAL_SCORE_WEIGHT or more either way,
+ * and such a score is a forced result; it becomes its disc difference, with
+ * proven set. Anything else is an evaluation and stays as it is.
+ */
+int Player::provenScore(int score, bool *proven) {
+    *proven = score >= FINAL_SCORE_WEIGHT || score <= -FINAL_SCORE_WEIGHT;
+    return *proven ? score / FINAL_SCORE_WEIGHT : score;
+}
+
+bool Player::probeTable(Board *board, Side side, TTEntry *entry) {
+    if (this->tt == nullptr) return false;
+    ScopedCounter counter(this->perf, PHASE_TT);
+    this->ttProbes++;
+    if (!this->tt->probe(board, side, entry)) return false;
+    this->ttHits++;
+    return true;
+}
+
+/*
+ * Stores a result unless the search it came from was cut short, in which
+ * case the score means nothing.
+ */
+void Player::storeTable(Board *board, Side side, int depth, int score, Bound bound, int move) {
+    if (this->tt == nullptr || this->aborted) return;
+    ScopedCounter counter(this->perf, PHASE_TT);
+    this->tt->store(board, side, depth, score, bound, move);
+}
+
+bool Player::probeEndgameTable(Board *board, Side side, EndgameEntry *entry) {
+    ScopedCounter counter(this->perf, PHASE_TT);
+    this->endgameProbes++;
+    if (!this->endgameTable->probe(board, side, entry)) return false;
+    this->endgameHits++;
+    return true;
+}
+
+/*
+ * Stores what the solver learned about a position unless the solve was cut
+ * short; the table's scores are exact, so a wrong one would never go away.
+ */
+void Player::storeEndgameTable(Board *board, Side side, int empties, int lower, int upper,
+        int move) {
+    if (this->aborted) return;
+    ScopedCounter counter(this->perf, PHASE_TT);
+    this->endgameTable->store(board, side, empties, lower, upper, move);
+}
+
 /**
  * @brief Performs a negamax with alpha-beta pruning on the provided board to
  *          determine the best next move
@@ -67,40 +680,318 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
  */
 std::pair<int, Move*> Player::negamax(Board *board, Side playingSide, int depth, int alpha, int beta)
 {
-    if (depth == 0 || !board->hasMoves(playingSide)) {
-        return std::pair<int, Move*>(board->getScore(this->side, true), nullptr);
+    int score = this->negamaxScore(board, playingSide, depth, alpha, beta);
+    return std::pair<int, Move*>(score, this->bestMove());
+}
+
+/**
+ * @brief The recursive part of negamax, which allocates nothing: child boards and move lists
+ *          live in the per-ply scratch space, and the best move is left in it too
+ *
+ * @return the highest minimum score that will occur
+ */
+int Player::negamaxScore(Board *board, Side playingSide, int depth, int alpha, int beta)
+{
+    this->nodes++;
+    this->pvLength[this->ply] = this->ply;
+    PlyScratch &scratch = this->scratch[this->ply];
+    scratch.best = -1;
+    if (this->outOfTime()) {
+        return 0;
+    }
+    if (this->ply >= MAX_SEARCH_PLY - 1) {
+        return this->evaluate(board, playingSide);
     }
-    
     Side oppositeSide = playingSide == WHITE ? BLACK : WHITE;
+
+    //if neither side can move the game is over and its score is exact, even
+    //where the search would otherwise stop and evaluate. Both sides' moves
+    //come from one pass over the board
+    Board::Bits blackMoves, whiteMoves;
+    this->legalMoves(board, &blackMoves, &whiteMoves);
+    if (blackMoves == 0 && whiteMoves == 0) {
+        return this->finalScore(board, playingSide);
+    }
+    if (depth == 0) {
+        return this->evaluate(board, playingSide, blackMoves, whiteMoves);
+    }
+
+    //a side with no move passes, which costs no depth since there is only one
+    //way to do it
+    Board::Bits legal = playingSide == BLACK ? blackMoves : whiteMoves;
+    if (legal == 0) {
+        this->ply++;
+        int passScore = -this->negamaxScore(board, oppositeSide, depth, -beta, -alpha);
+        this->ply--;
+        this->updatePv(-1);
+        return passScore;
+    }
+
+    //a stored result from a search at least this deep can settle the node
+    //outright; the root is always searched so that there is a move to play.
+    //Otherwise the stored best move is tried first
+    int hashMove = -1;
+    TTEntry entry;
+    if (this->probeTable(board, playingSide, &entry)) {
+        hashMove = entry.move;
+        if (this->ply > 0 && entry.depth >= depth
+                && (entry.bound == BOUND_EXACT
+                    || (entry.bound == BOUND_LOWER && entry.score >= beta)
+                    || (entry.bound == BOUND_UPPER && entry.score <= alpha))) {
+            this->ttCutoffs++;
+            return std::max(alpha, std::min(beta, entry.score));
+        }
+    }
+
+    //with nothing from the table to try first and a lot of depth left, a
+    //cheaper search of this same node finds a good first move, and leaves
+    //the table holding results for the children the full search will visit.
+    //Null windows only have to show a bound, so they go without
+    if (hashMove < 0 && this->iidDepth > 0 && depth >= this->iidDepth
+            && depth > this->iidReduction && beta - alpha > 1) {
+        this->iidSearches++;
+        this->negamaxScore(board, playingSide, depth - this->iidReduction, alpha, beta);
+        if (this->aborted) {
+            return 0;
+        }
+        hashMove = scratch.best;
+        scratch.best = -1;
+        this->pvLength[this->ply] = this->ply;
+    }
     
     //find move that results in highest score
-    Move *moveMade = nullptr;
-    // int bestValue = INT_MIN;
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        for (int j = 0; j < BOARD_SIZE; j++) {
-            Move *testMove = new Move(i, j);
-            //only check valid moves
-            //this effectively finds "child nodes" (boards) of the provided
-            //board - it is all boards that could result with valid moves
-            if (this->board->checkMove(testMove, playingSide)) {
-                Board *childBoard = this->board->copy();
-                childBoard->doMove(testMove, playingSide);
-                std::pair<int, Move*> childResults = this->negamax(childBoard, oppositeSide, depth - 1, -beta, -alpha);
-                int boardScore = -childResults.first;
-                if (boardScore > alpha) {
-                    alpha = boardScore;
-                    moveMade = new Move(i, j);
-                }
-                if (boardScore > beta) {
-                    return std::pair<int, Move*>(beta, new Move(i, j));
-                }
-                delete childBoard;
+    //this effectively finds "child nodes" (boards) of the provided board - it
+    //is all boards that could result with valid moves
+    this->orderMoves(board, playingSide, legal, hashMove, depth, &scratch.moves);
+    for (int k = 0; k < scratch.moves.count; k++) {
+        int square = scratch.moves.squares[k];
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        Board *childBoard = this->makeMove(board, &move, playingSide);
+        this->ply++;
+        int boardScore = -this->negamaxScore(childBoard, oppositeSide, depth - 1, -beta, -alpha);
+        this->ply--;
+        if (boardScore > alpha) {
+            alpha = boardScore;
+            scratch.best = square;
+            this->updatePv(square);
+        }
+        if (boardScore >= beta) {
+            this->cutoffs++;
+            if (k == 0) this->firstMoveCutoffs++;
+            scratch.best = square;
+            this->storeTable(board, playingSide, depth, beta, BOUND_LOWER, square);
+            return beta;
+        }
+    }
+    this->storeTable(board, playingSide, depth, alpha,
+        scratch.best >= 0 ? BOUND_EXACT : BOUND_UPPER, scratch.best);
+    return alpha;
+
+}
+
+/*
+ * Returns the best move the search found at the current ply, as a new Move
+ * the caller owns, or nullptr if there is none.
+ */
+Move *Player::bestMove() {
+    int square = this->scratch[this->ply].best;
+    return square < 0 ? nullptr : new Move(square % BOARD_SIZE, square / BOARD_SIZE);
+}
+
+/**
+ * @brief Solves the player's current board exactly, with no time limit
+ *
+ * @return a pair - the first element is the final disc difference for the player with perfect
+ *                  play and the second element is a move that achieves it
+ */
+std::pair<int, Move*> Player::solveEndgame()
+{
+    this->nodes = 0;
+    this->cutoffs = 0;
+    this->firstMoveCutoffs = 0;
+    this->timed = false;
+    this->aborted = false;
+    this->ply = 0;
+    this->arena->release(this->searchMark);
+    std::pair<int, Move*> results = this->endgame(this->board, this->side, -BOARD_SQUARES,
+        BOARD_SQUARES, false);
+    this->resetStats();
+    this->last.score = results.first;
+    this->last.depth = BOARD_SQUARES - this->board->countBlack() - this->board->countWhite();
+    this->last.solved = true;
+    this->last.proven = true;
+    this->last.nodes = this->nodes;
+    this->last.cutoffs = this->cutoffs;
+    this->last.firstMoveCutoffs = this->firstMoveCutoffs;
+    this->last.arenaPeak = this->arena->getPeak();
+    this->last.pv.assign(this->pvTable[0], this->pvTable[0] + this->pvLength[0]);
+    return results;
+}
+
+/**
+ * @brief Scores every legal move on the player's board with a full window, untimed, for
+ *          analysis that wants more than the best move
+ *
+ * @param depth the depth to search each move to, counting the move itself
+ * @param solve true to search each move to the end of the game instead
+ *
+ * @return the player's legal moves with their scores, best first
+ */
+std::vector<MoveScore> Player::scoreMoves(int depth, bool solve)
+{
+    this->nodes = 0;
+    this->cutoffs = 0;
+    this->firstMoveCutoffs = 0;
+    this->ttProbes = 0;
+    this->ttHits = 0;
+    this->ttCutoffs = 0;
+    this->iidSearches = 0;
+    this->endgameProbes = 0;
+    this->endgameHits = 0;
+    this->endgameCutoffs = 0;
+    this->timed = false;
+    this->aborted = false;
+    this->ply = 0;
+    this->arena->release(this->searchMark);
+    this->resetStats();
+
+    Side oppositeSide = this->side == WHITE ? BLACK : WHITE;
+    std::vector<MoveScore> scores;
+    MoveList &moves = this->scratch[0].moves;
+    this->orderMoves(this->board, this->side, this->legalMoves(this->board, this->side), -1, 0,
+        &moves);
+    for (int k = 0; k < moves.count; k++) {
+        int square = moves.squares[k];
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        Board *childBoard = this->makeMove(this->board, &move, this->side);
+        this->ply = 1;
+        int childScore = solve
+            ? this->endgameScore(childBoard, oppositeSide, -BOARD_SQUARES, BOARD_SQUARES, false)
+            : this->negamaxScore(childBoard, oppositeSide, depth - 1, INT_MIN + 1, INT_MAX);
+        this->ply = 0;
+        MoveScore moveScore = { square, -childScore, solve };
+        scores.push_back(moveScore);
+    }
+    std::stable_sort(scores.begin(), scores.end(),
+        [](const MoveScore &a, const MoveScore &b) { return a.score > b.score; });
+    //only now, as the search's own scores are what the moves are ranked by
+    if (!solve) {
+        for (size_t k = 0; k < scores.size(); k++) {
+            scores[k].score = this->provenScore(scores[k].score, &scores[k].proven);
+        }
+    }
+
+    this->last.depth = solve
+        ? BOARD_SQUARES - this->board->countBlack() - this->board->countWhite() : depth;
+    this->last.solved = solve;
+    this->last.proven = !scores.empty() && scores[0].proven;
+    this->last.score = scores.empty() ? 0 : scores[0].score;
+    this->last.nodes = this->nodes;
+    this->last.cutoffs = this->cutoffs;
+    this->last.firstMoveCutoffs = this->firstMoveCutoffs;
+    this->last.arenaPeak = this->arena->getPeak();
+    return scores;
+}
+
+/**
+ * @brief Performs an alpha-beta search to the end of the game, scoring finished games by their
+ *          disc difference
+ *
+ * @param board the board to search
+ * @param playingSide the player that is playing
+ * @param alpha the value of the alpha parameter (initial value is -BOARD_SQUARES)
+ * @param beta the value of the beta parameter (initial value is BOARD_SQUARES)
+ * @param passed true if the other player passed on the previous turn
+ *
+ * @return a pair - the first element is the final disc difference for playingSide with perfect
+ *                  play and the second element is the move that achieves it
+ */
+std::pair<int, Move*> Player::endgame(Board *board, Side playingSide, int alpha, int beta, bool passed)
+{
+    int score = this->endgameScore(board, playingSide, alpha, beta, passed);
+    return std::pair<int, Move*>(score, this->bestMove());
+}
+
+/**
+ * @brief The recursive part of endgame, which like negamaxScore allocates nothing and leaves
+ *          the best move in the per-ply scratch space
+ *
+ * @return the final disc difference for playingSide with perfect play
+ */
+int Player::endgameScore(Board *board, Side playingSide, int alpha, int beta, bool passed)
+{
+    this->nodes++;
+    this->pvLength[this->ply] = this->ply;
+    PlyScratch &scratch = this->scratch[this->ply];
+    scratch.best = -1;
+    if (this->outOfTime()) {
+        return 0;
+    }
+
+    Side oppositeSide = playingSide == WHITE ? BLACK : WHITE;
+
+    //bounds stored by an earlier visit can settle the node, except at the
+    //root, which needs a move; otherwise the stored move goes first
+    int empties = BOARD_SQUARES - board->countBlack() - board->countWhite();
+    bool useTable = this->endgameTable != nullptr && empties >= ENDGAME_TT_MIN_EMPTIES;
+    int hashMove = -1;
+    EndgameEntry entry;
+    if (useTable && this->probeEndgameTable(board, playingSide, &entry)) {
+        hashMove = entry.move;
+        if (this->ply > 0 && (entry.lower >= beta || entry.upper <= alpha
+                || entry.lower == entry.upper)) {
+            this->endgameCutoffs++;
+            return std::max(alpha, std::min(beta, (int) entry.lower));
+        }
+    }
+
+    int firstAlpha = alpha;
+    this->orderMoves(board, playingSide, this->legalMoves(board, playingSide), hashMove, 0,
+        &scratch.moves);
+    for (int k = 0; k < scratch.moves.count; k++) {
+        int square = scratch.moves.squares[k];
+        Move move(square % BOARD_SIZE, square / BOARD_SIZE);
+        Board *childBoard = this->makeMove(board, &move, playingSide);
+        this->ply++;
+        int boardScore = -this->endgameScore(childBoard, oppositeSide, -beta, -alpha, false);
+        this->ply--;
+        //the first move is kept even if it fails low so there is always a
+        //move to play at the root
+        if (boardScore > alpha || scratch.best < 0) {
+            alpha = max(alpha, boardScore);
+            scratch.best = square;
+            this->updatePv(square);
+        }
+        if (boardScore >= beta) {
+            this->cutoffs++;
+            if (k == 0) this->firstMoveCutoffs++;
+            scratch.best = square;
+            if (useTable) {
+                this->storeEndgameTable(board, playingSide, empties, beta, BOARD_SQUARES, square);
             }
-            delete testMove;
+            return beta;
         }
     }
-    return std::pair<int, Move*>(alpha, moveMade);
 
+    if (scratch.moves.count == 0) {
+        //two passes in a row end the game
+        if (passed) {
+            return board->count(playingSide) - board->count(oppositeSide);
+        }
+        this->ply++;
+        int passScore = -this->endgameScore(board, oppositeSide, -beta, -alpha, true);
+        this->ply--;
+        this->updatePv(-1);
+        return passScore;
+    }
+    if (useTable) {
+        if (alpha > firstAlpha) {
+            this->storeEndgameTable(board, playingSide, empties, alpha, alpha, scratch.best);
+        } else {
+            this->storeEndgameTable(board, playingSide, empties, -BOARD_SQUARES, alpha, -1);
+        }
+    }
+    return alpha;
 }
 
 /**
@@ -3,10 +3,112 @@
 
 #include <iostream>
 #include <utility>
+#include <chrono>
+#include <vector>
 #include "common.hpp"
 #include "board.hpp"
+#include "evaluator.hpp"
+#include "arena.hpp"
+#include "memory.hpp"
+#include "perfcounters.hpp"
+#include "trace.hpp"
+#include "tt.hpp"
 using namespace std;
 
+// Depth iterative deepening goes to when the clock does not stop it first
+#define DEFAULT_SEARCH_DEPTH (7)
+// With this many empty squares or fewer the game is solved exactly
+#define DEFAULT_ENDGAME_EMPTIES (10)
+// Deepest ply a search can reach, passes included
+#define MAX_SEARCH_PLY (128)
+// Size of each player's search arena, which holds the per-ply scratch space
+#define SEARCH_ARENA_BYTES (64 * 1024)
+// What a disc of difference is worth when the heuristic search reaches the
+// end of the game; more than the evaluation can give a whole board
+#define FINAL_SCORE_WEIGHT (1000)
+// A node with at least this much depth left and no move from the table first
+// searches itself DEFAULT_IID_REDUCTION plies shallower to find one to try
+// first; 0 turns this internal iterative deepening off
+#define DEFAULT_IID_DEPTH (4)
+#define DEFAULT_IID_REDUCTION (2)
+// Evaluators for the leaves and for ordering moves; a node orders its moves
+// with the ordering evaluator only if it has at least ORDER_EVAL_DEPTH plies
+// left, since closer to the leaves the scoring costs more than it saves
+#define DEFAULT_LEAF_EVAL (EVAL_MOBILITY)
+#define DEFAULT_ORDER_EVAL (EVAL_WEIGHTED)
+#define ORDER_EVAL_DEPTH (3)
+// The endgame solver only uses its table at nodes with at least this many
+// empty squares; nearer the end searching again is cheaper than looking up
+#define ENDGAME_TT_MIN_EMPTIES (5)
+// A timed search stops deepening once the same root move has been best for
+// this many completed iterations and no other move comes within
+// EARLY_STOP_MARGIN of it in a search EARLY_STOP_REDUCTION plies shallower
+#define EARLY_STOP_ITERATIONS (3)
+#define EARLY_STOP_MARGIN (8)
+#define EARLY_STOP_REDUCTION (2)
+// A root solve may take up to 1/ENDGAME_SOLVE_SHARE of the move's time before
+// it gives up and leaves the rest to iterative deepening
+#define ENDGAME_SOLVE_SHARE (2)
+// A forced move is not searched to choose it, but still scored by a search
+// this deep, or exactly when it is within reach of the endgame solver
+#define FORCED_SCORE_DEPTH (4)
+
+/*
+ * What the most recent doMove search did. Squares in the principal variation
+ * are x + BOARD_SIZE*y, with -1 for a pass.
+ *
+ * The score is for the side to move. A proven score is a final disc
+ * difference: the exact one after a solve, or one the heuristic search saw
+ * could be forced, a win at least this big or a loss at least this bad. Any
+ * other score is in evaluator units.
+ */
+struct SearchStats {
+    int depth;
+    bool solved;
+    bool proven;
+    int score;
+    unsigned long long nodes;
+    unsigned long long cutoffs;
+    unsigned long long firstMoveCutoffs;
+    unsigned long long ttProbes;
+    unsigned long long ttHits;
+    unsigned long long ttCutoffs;
+    unsigned long long iidSearches;
+    unsigned long long endgameProbes;
+    unsigned long long endgameHits;
+    unsigned long long endgameCutoffs;
+    int msLeft;
+    long budgetMs;
+    long timeMs;
+    // Why the search ended: "forced", "solved", "stable", "time" or "depth"
+    const char *stop;
+    std::vector<int> pv;
+    // Most of the search arena ever in use
+    size_t arenaPeak;
+    // Hardware counters per search phase, if they were enabled and available
+    bool perfAvailable;
+    PerfTotals perf[PHASE_COUNT];
+};
+
+/*
+ * A root move and its score, in the units SearchStats uses.
+ */
+struct MoveScore {
+    int square;             // x + BOARD_SIZE*y
+    int score;
+    bool proven;
+};
+
+/*
+ * What the search keeps for one ply: the board after the move that led to it,
+ * the legal moves in the order they are tried, and the best move found.
+ */
+struct PlyScratch {
+    Board board;
+    MoveList moves;
+    int best;
+};
+
 class Player {
 
 public:
@@ -17,12 +119,114 @@ public:
 
     // Flag to tell if the player is running within the test_minimax context
     bool testingMinimax;
-    void setBoard(Board *aBoard) { this->board = aBoard; }
+    void setBoard(Board *aBoard);
+    void setSide(Side side) { this->side = side; }
+    void setSearchDepth(int depth) { this->maxDepth = depth; }
+    void setEndgameEmpties(int empties) { this->endgameEmpties = empties; }
+    void setInternalDeepening(int depth, int reduction);
+    void setEvaluators(EvalKind leaf, EvalKind order);
+    void setTelemetry(ostream *out) { this->telemetry = out; }
+    void setPerfCounters(bool enabled);
+    void setTrace(TraceWriter *writer) { this->traceWriter = writer; }
+    void setTranspositionTable(TranspositionTable *table) { this->tt = table; }
+    void setEndgameTable(EndgameTable *table) { this->endgameTable = table; }
+    int getLastScore() { return this->last.score; }
+    int getLastDepth() { return this->last.depth; }
+    unsigned long long getLastNodes() { return this->last.nodes; }
+    const SearchStats &getLastStats() { return this->last; }
+    const TraceMove &getLastTrace() { return this->trace; }
+    Move *replay(const TraceMove &recorded);
     std::pair<int, Move*> minimax(Board *board, int depth, bool maximizingPlayer);
     std::pair<int, Move*> negamax(Board *board, Side playingSide, int depth, int alpha, int beta);
+    std::pair<int, Move*> solveEndgame();
+    std::vector<MoveScore> scoreMoves(int depth, bool solve);
+    std::pair<int, Move*> endgame(Board *board, Side playingSide, int alpha, int beta, bool passed);
 private:
     Board *board;
     Side side;
+
+    // Iterative deepening stops at this depth even if time remains
+    int maxDepth;
+    int endgameEmpties;
+    // Internal iterative deepening: the least depth it is used at, 0 for
+    // never, and how much shallower the search for a first move is
+    int iidDepth;
+    int iidReduction;
+    // The leaf evaluator is always set; without an ordering evaluator moves
+    // are tried from the lowest square up
+    EvalKind leafEval;
+    EvalKind orderEval;
+    Evaluator *leafEvaluator;
+    Evaluator *orderEvaluator;
+    // Statistics of the most recent search, written as a JSON line to
+    // telemetry after every move if it is set
+    SearchStats last;
+    ostream *telemetry;
+    PerfCounters *perf;
+    // Inputs and checkpoints of the most recent search, written to
+    // traceWriter after every move if it is set
+    TraceMove trace;
+    TraceWriter *traceWriter;
+    // The trace being replayed, if any; its abort points stand in for the clock
+    const TraceMove *replaying;
+    // Shared with other players if the caller wants; not owned
+    TranspositionTable *tt;
+    EndgameTable *endgameTable;
+
+    // Per-search state used to abort an iteration that runs out of time
+    unsigned long long nodes;
+    unsigned long long cutoffs;
+    unsigned long long firstMoveCutoffs;
+    unsigned long long ttProbes;
+    unsigned long long ttHits;
+    unsigned long long ttCutoffs;
+    unsigned long long iidSearches;
+    unsigned long long endgameProbes;
+    unsigned long long endgameHits;
+    unsigned long long endgameCutoffs;
+    bool timed;
+    bool abortable;
+    bool aborted;
+    std::chrono::steady_clock::time_point deadline;
+
+    // The search's memory: scratch[ply] for each ply from the root, and
+    // anything allocated after searchMark, which is released every search
+    Arena *arena;
+    PlyScratch *scratch;
+    size_t searchMark;
+
+    // Triangular principal variation table, indexed by ply from the root
+    int ply;
+    int pvLength[MAX_SEARCH_PLY];
+    int pvTable[MAX_SEARCH_PLY][MAX_SEARCH_PLY];
+
+    Move *search(int msLeft);
+    void resetStats();
+    void resetTrace();
+    void checkpoint(int square);
+    bool clearlyBest(int best, int depth, int bound);
+    int negamaxScore(Board *board, Side playingSide, int depth, int alpha, int beta);
+    int endgameScore(Board *board, Side playingSide, int alpha, int beta, bool passed);
+    Move *bestMove();
+    bool outOfTime();
+    void updatePv(int square);
+
+    // Board operations used by the search, measured by the counters
+    Board::Bits legalMoves(Board *board, Side side);
+    void legalMoves(Board *board, Board::Bits *blackMoves, Board::Bits *whiteMoves);
+    Board *makeMove(Board *board, Move *move, Side side);
+    void orderMoves(Board *board, Side side, Board::Bits legal, int first, int depth,
+        MoveList *moves);
+    int evaluate(Board *board, Side side);
+    int evaluate(Board *board, Side side, Board::Bits blackMoves, Board::Bits whiteMoves);
+    int orderScore(Board *board, Side side);
+    int finalScore(Board *board, Side side);
+    static int provenScore(int score, bool *proven);
+    bool probeTable(Board *board, Side side, TTEntry *entry);
+    void storeTable(Board *board, Side side, int depth, int score, Bound bound, int move);
+    bool probeEndgameTable(Board *board, Side side, EndgameEntry *entry);
+    void storeEndgameTable(Board *board, Side side, int empties, int lower, int upper, int move);
+    void writeTelemetry();
 };
 
 #endif
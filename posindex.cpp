@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+#include "positionindex.hpp"
+using namespace std;
+
+/*
+ * Builds and queries an index of canonical positions over position record
+ * files (from selfplay or wthor). Each position is reduced over the board's
+ * symmetries and counted with its wins, losses and final disc differences
+ * from the side to move's view.
+ *
+ *   posindex build [-j threads] [-m runMB] [-T tmpdir] index records...
+ *   posindex query index [positions...]
+ *
+ * Queries take positions in the form parsePosition reads, from the command
+ * line or one per line on standard input.
+ */
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " build [-j threads] [-m runMB] [-T tmpdir] index records..." << endl;
+    cerr << "       " << name << " query index [positions...]" << endl;
+    exit(-1);
+}
+
+static int build(int argc, char *argv[]) {
+    int threads = thread::hardware_concurrency();
+    size_t runMB = 256;
+    const char *tmpDir = "/tmp";
+
+    optind = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "j:m:T:")) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'm': runMB = strtoul(optarg, nullptr, 10); break;
+            case 'T': tmpDir = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (argc - optind < 2 || runMB < 1) usage(argv[0]);
+    if (threads < 1) threads = 1;
+
+    vector<string> records(argv + optind + 1, argv + argc);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string error;
+    if (!buildPositionIndex(records, argv[optind], tmpDir, runMB, threads, error)) {
+        cerr << "posindex: " << error << endl;
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    PositionIndex index;
+    if (!index.open(argv[optind])) {
+        cerr << "posindex: cannot read back " << argv[optind] << endl;
+        return 1;
+    }
+    cout << argv[optind] << ": " << index.size() << " positions, built in " << seconds << " s"
+         << endl;
+    return 0;
+}
+
+static void query(PositionIndex &index, const string &text) {
+    Board board;
+    Side side;
+    if (!parsePosition(text, &board, &side)) {
+        cout << text << " bad position" << endl;
+        return;
+    }
+    IndexEntry entry;
+    cout << formatPosition(&board, side);
+    if (!index.find(&board, side, &entry)) {
+        cout << " count 0" << endl;
+        return;
+    }
+    cout << " count " << entry.count << " wins " << entry.wins
+         << " draws " << entry.count - entry.wins - entry.losses << " losses " << entry.losses
+         << " average " << fixed << setprecision(2) << (double) entry.discSum / entry.count
+         << endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) usage(argv[0]);
+    if (!strcmp(argv[1], "build")) return build(argc, argv);
+    if (strcmp(argv[1], "query") || argc < 3) usage(argv[0]);
+
+    PositionIndex index;
+    if (!index.open(argv[2])) {
+        cerr << "posindex: cannot read " << argv[2] << " as a position index" << endl;
+        exit(-1);
+    }
+    if (argc > 3) {
+        for (int i = 3; i < argc; i++) {
+            query(index, argv[i]);
+        }
+    } else {
+        string line;
+        while (getline(cin, line)) {
+            if (!line.empty() && line[0] != '#') query(index, line);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include "positionindex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char INDEX_MAGIC[8] = { 'Q', 'W', 'P', 'I', 'D', 'X', '0', '1' };
+static const size_t INDEX_HEADER_BYTES = 16;
+
+/*
+ * Mirrors the board top to bottom (y becomes 7 - y).
+ */
+static uint64_t flipVertical(uint64_t b) {
+    return __builtin_bswap64(b);
+}
+
+/*
+ * Mirrors the board left to right (x becomes 7 - x).
+ */
+static uint64_t mirrorHorizontal(uint64_t b) {
+    b = ((b >> 1) & 0x5555555555555555ULL) | ((b & 0x5555555555555555ULL) << 1);
+    b = ((b >> 2) & 0x3333333333333333ULL) | ((b & 0x3333333333333333ULL) << 2);
+    b = ((b >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((b & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return b;
+}
+
+/*
+ * Reflects the board in the a1-h8 diagonal (x and y swap).
+ */
+static uint64_t flipDiagonal(uint64_t b) {
+    uint64_t t;
+    t = 0x0F0F0F0F00000000ULL & (b ^ (b << 28));
+    b ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (b ^ (b << 14));
+    b ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (b ^ (b << 7));
+    b ^= t ^ (t >> 7);
+    return b;
+}
+
+/*
+ * Returns the smallest of the position's eight symmetric forms.
+ */
+PositionKey canonicalKey(uint64_t player, uint64_t opponent) {
+    PositionKey best = { player, opponent };
+    for (int s = 1; s < 8; s++) {
+        uint64_t p = player, o = opponent;
+        if (s & 1) {
+            p = flipVertical(p);
+            o = flipVertical(o);
+        }
+        if (s & 2) {
+            p = mirrorHorizontal(p);
+            o = mirrorHorizontal(o);
+        }
+        if (s & 4) {
+            p = flipDiagonal(p);
+            o = flipDiagonal(o);
+        }
+        PositionKey key = { p, o };
+        if (key < best) best = key;
+    }
+    return best;
+}
+
+IndexEntry entryFromRecord(const PositionRecord &record) {
+    bool black = (record.side == BLACK);
+    int result = black ? record.result : -record.result;
+    IndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.key = canonicalKey(black ? record.black : record.white,
+                             black ? record.white : record.black);
+    entry.count = 1;
+    entry.wins = result > 0;
+    entry.losses = result < 0;
+    entry.discSum = result;
+    return entry;
+}
+
+void IndexEntry::add(const IndexEntry &other) {
+    count += other.count;
+    wins += other.wins;
+    losses += other.losses;
+    discSum += other.discSum;
+}
+
+static bool keyLess(const IndexEntry &a, const IndexEntry &b) {
+    return a.key < b.key;
+}
+
+/*
+ * A record file mapped for reading.
+ */
+struct RecordSource {
+    const PositionRecord *records;
+    size_t count;
+    size_t length;
+};
+
+/*
+ * A run of consecutive records in one source, small enough to sort in memory.
+ */
+struct RecordRun {
+    const RecordSource *source;
+    size_t first, count;
+};
+
+/*
+ * Sorts a run's entries and adds up the ones for the same position, writing
+ * the result to path.
+ */
+static bool writeRun(const RecordRun &run, const std::string &path, std::vector<IndexEntry> &buffer) {
+    buffer.clear();
+    for (size_t i = run.first; i < run.first + run.count; i++) {
+        buffer.push_back(entryFromRecord(run.source->records[i]));
+    }
+    std::sort(buffer.begin(), buffer.end(), keyLess);
+    size_t out = 0;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        if (out > 0 && buffer[out - 1].key == buffer[i].key) {
+            buffer[out - 1].add(buffer[i]);
+        } else {
+            buffer[out++] = buffer[i];
+        }
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    bool ok = fwrite(buffer.data(), sizeof(IndexEntry), out, file) == out;
+    return (fclose(file) == 0) && ok;
+}
+
+/*
+ * Merges sorted run files into the index, adding up entries for the same
+ * position across runs.
+ */
+static bool mergeRuns(const std::vector<std::string> &runPaths, const std::string &path) {
+    std::vector<FILE*> runs;
+    std::vector<IndexEntry> heads(runPaths.size());
+    typedef std::pair<PositionKey, size_t> HeapItem;
+    auto later = [](const HeapItem &a, const HeapItem &b) { return b.first < a.first; };
+    std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(later)> heap(later);
+
+    bool ok = true;
+    for (size_t r = 0; r < runPaths.size(); r++) {
+        FILE *run = fopen(runPaths[r].c_str(), "rb");
+        runs.push_back(run);
+        if (run == nullptr) {
+            ok = false;
+        } else if (fread(&heads[r], sizeof(IndexEntry), 1, run) == 1) {
+            heap.push(HeapItem(heads[r].key, r));
+        }
+    }
+
+    FILE *out = ok ? fopen(path.c_str(), "wb") : nullptr;
+    uint64_t written = 0;
+    ok = ok && out != nullptr && fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, out) == 1
+        && fwrite(&written, sizeof(written), 1, out) == 1;
+    IndexEntry pending;
+    bool havePending = false;
+    while (ok && !heap.empty()) {
+        size_t r = heap.top().second;
+        heap.pop();
+        if (havePending && pending.key == heads[r].key) {
+            pending.add(heads[r]);
+        } else {
+            if (havePending) {
+                ok = fwrite(&pending, sizeof(pending), 1, out) == 1;
+                written++;
+            }
+            pending = heads[r];
+            havePending = true;
+        }
+        if (fread(&heads[r], sizeof(IndexEntry), 1, runs[r]) == 1) {
+            heap.push(HeapItem(heads[r].key, r));
+        }
+    }
+    if (ok && havePending) {
+        ok = fwrite(&pending, sizeof(pending), 1, out) == 1;
+        written++;
+    }
+    ok = ok && fseek(out, sizeof(INDEX_MAGIC), SEEK_SET) == 0
+        && fwrite(&written, sizeof(written), 1, out) == 1;
+
+    for (size_t r = 0; r < runs.size(); r++) {
+        if (runs[r] != nullptr) fclose(runs[r]);
+    }
+    if (out != nullptr && fclose(out) != 0) ok = false;
+    return ok;
+}
+
+bool buildPositionIndex(const std::vector<std::string> &recordFiles, const char *indexPath,
+        const char *tmpDir, size_t runMegabytes, int threads, std::string &error) {
+    std::vector<RecordSource> sources(recordFiles.size());
+    std::vector<RecordRun> work;
+    size_t runRecords = std::max((size_t) 1, (runMegabytes << 20) / sizeof(IndexEntry));
+    bool ok = true;
+    for (size_t f = 0; f < recordFiles.size(); f++) {
+        RecordSource &source = sources[f];
+        source.records = nullptr;
+        source.count = source.length = 0;
+        int fd = open(recordFiles[f].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0 || st.st_size % sizeof(PositionRecord) != 0) {
+            error = "cannot read " + recordFiles[f] + " as position records";
+            if (fd >= 0) close(fd);
+            ok = false;
+            break;
+        }
+        if (st.st_size > 0) {
+            void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                error = "cannot map " + recordFiles[f];
+                close(fd);
+                ok = false;
+                break;
+            }
+            madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+            source.records = static_cast<const PositionRecord *>(mapped);
+            source.length = st.st_size;
+            source.count = st.st_size / sizeof(PositionRecord);
+        }
+        close(fd);
+        for (size_t first = 0; first < source.count; first += runRecords) {
+            RecordRun run = { &source, first, std::min(runRecords, source.count - first) };
+            work.push_back(run);
+        }
+    }
+
+    // Sort the runs in parallel.
+    std::vector<std::string> runPaths;
+    for (size_t r = 0; r < work.size(); r++) {
+        runPaths.push_back(std::string(tmpDir) + "/posindex." + std::to_string(getpid())
+                + "." + std::to_string(r) + ".run");
+    }
+    std::atomic<size_t> nextRun(0);
+    std::atomic<bool> failed(!ok);
+    std::vector<std::thread> pool;
+    for (int t = 0; ok && t < threads; t++) {
+        pool.push_back(std::thread([&]() {
+            std::vector<IndexEntry> buffer;
+            size_t r;
+            while (!failed && (r = nextRun++) < work.size()) {
+                if (!writeRun(work[r], runPaths[r], buffer)) failed = true;
+            }
+        }));
+    }
+    for (size_t t = 0; t < pool.size(); t++) {
+        pool[t].join();
+    }
+    if (ok && failed) {
+        error = std::string("cannot write run files in ") + tmpDir;
+        ok = false;
+    }
+
+    // Merge them into a temporary file that replaces the index only once it
+    // is complete.
+    std::string partial = std::string(indexPath) + ".partial";
+    if (ok && !mergeRuns(runPaths, partial)) {
+        error = std::string("cannot write ") + partial;
+        ok = false;
+    }
+    if (ok && rename(partial.c_str(), indexPath) != 0) {
+        error = std::string("cannot rename ") + partial + " to " + indexPath;
+        ok = false;
+    }
+    if (!ok) unlink(partial.c_str());
+
+    for (size_t r = 0; r < runPaths.size(); r++) {
+        unlink(runPaths[r].c_str());
+    }
+    for (size_t f = 0; f < sources.size(); f++) {
+        if (sources[f].records != nullptr) {
+            munmap(const_cast<PositionRecord *>(sources[f].records), sources[f].length);
+        }
+    }
+    return ok;
+}
+
+PositionIndex::PositionIndex() {
+    data = nullptr;
+    length = 0;
+    entries = 0;
+}
+
+PositionIndex::~PositionIndex() {
+    close();
+}
+
+/*
+ * Maps an index file and checks its header.
+ */
+bool PositionIndex::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < INDEX_HEADER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+    data = static_cast<const uint8_t *>(mapped);
+    length = st.st_size;
+
+    uint64_t count;
+    memcpy(&count, data + sizeof(INDEX_MAGIC), sizeof(count));
+    if (memcmp(data, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+            || count != (length - INDEX_HEADER_BYTES) / sizeof(IndexEntry)) {
+        close();
+        return false;
+    }
+    entries = count;
+    return true;
+}
+
+void PositionIndex::close() {
+    if (data != nullptr) munmap(const_cast<uint8_t *>(data), length);
+    data = nullptr;
+    length = 0;
+    entries = 0;
+}
+
+/*
+ * Looks up a position by binary search. Returns false if it never occurred.
+ */
+bool PositionIndex::find(Board *board, Side toMove, IndexEntry *entry) {
+    Side other = (toMove == BLACK) ? WHITE : BLACK;
+    IndexEntry wanted;
+    memset(&wanted, 0, sizeof(wanted));
+    wanted.key = canonicalKey(board->getBits(toMove), board->getBits(other));
+    const IndexEntry *first = reinterpret_cast<const IndexEntry *>(data + INDEX_HEADER_BYTES);
+    const IndexEntry *last = first + entries;
+    const IndexEntry *found = std::lower_bound(first, last, wanted, keyLess);
+    if (found == last || !(found->key == wanted.key)) return false;
+    *entry = *found;
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef __POSITIONINDEX_H__
+#define __POSITIONINDEX_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common.hpp"
+#include "board.hpp"
+#include "record.hpp"
+
+/*
+ * A position seen from the side to move, reduced over the eight symmetries
+ * of the board to the one with the smallest (player, opponent) pair. Two
+ * positions that are rotations or reflections of each other, or the same
+ * with colors and side to move swapped, have the same key.
+ */
+struct PositionKey {
+    uint64_t player;        // squares of the side to move, bit x + 8*y
+    uint64_t opponent;
+
+    bool operator<(const PositionKey &other) const {
+        return player < other.player || (player == other.player && opponent < other.opponent);
+    }
+    bool operator==(const PositionKey &other) const {
+        return player == other.player && opponent == other.opponent;
+    }
+};
+
+/*
+ * Statistics for one canonical position, from the side to move's view. This
+ * is also the on-disk layout of the index, after a 16 byte header.
+ */
+struct IndexEntry {
+    PositionKey key;
+    uint32_t count;
+    uint32_t wins;
+    uint32_t losses;
+    uint32_t reserved;
+    int64_t discSum;        // sum of final disc differences
+
+    void add(const IndexEntry &other);
+};
+
+static_assert(sizeof(IndexEntry) == 40, "IndexEntry must stay 40 bytes");
+
+PositionKey canonicalKey(uint64_t player, uint64_t opponent);
+IndexEntry entryFromRecord(const PositionRecord &record);
+
+/*
+ * Builds an index from position record files with an external sort: worker
+ * threads turn runs of records into sorted, aggregated run files in tmpDir,
+ * which are then merged into the index. At most runMegabytes of entries are
+ * held in memory per thread. Returns false and sets error on failure.
+ */
+bool buildPositionIndex(const std::vector<std::string> &recordFiles, const char *indexPath,
+        const char *tmpDir, size_t runMegabytes, int threads, std::string &error);
+
+/*
+ * A finished index mapped read-only into memory and searched in place.
+ */
+class PositionIndex {
+
+public:
+    PositionIndex();
+    ~PositionIndex();
+
+    bool open(const char *path);
+    void close();
+
+    size_t size() { return entries; }
+    bool find(Board *board, Side toMove, IndexEntry *entry);
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t entries;
+};
+
+#endif
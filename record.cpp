@@ -0,0 +1,84 @@
+#include "record.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Makes a writer with no file attached.
+ */
+RecordWriter::RecordWriter() {
+    fd = -1;
+    syncEvery = 0;
+    unsynced = 0;
+}
+
+/*
+ * Flushes and closes the file, if one is open.
+ */
+RecordWriter::~RecordWriter() {
+    close();
+}
+
+/*
+ * Opens the data file for appending, creating it if needed. A syncEvery of 0
+ * only syncs when the writer is closed. Returns false if the file could not
+ * be opened.
+ */
+bool RecordWriter::open(const char *path, size_t syncEvery) {
+    close();
+    fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    this->syncEvery = syncEvery;
+    unsynced = 0;
+    return fd >= 0;
+}
+
+/*
+ * Appends a batch of records with a single write so a batch from one game is
+ * never interleaved with another thread's. Returns false on a write error.
+ */
+bool RecordWriter::write(const PositionRecord *records, size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd < 0) return false;
+
+    const char *data = reinterpret_cast<const char *>(records);
+    size_t left = count * sizeof(PositionRecord);
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        left -= written;
+    }
+
+    unsynced += count;
+    if (syncEvery > 0 && unsynced >= syncEvery) {
+        fsync(fd);
+        unsynced = 0;
+    }
+    return true;
+}
+
+/*
+ * Forces everything written so far out to disk.
+ */
+void RecordWriter::sync() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd >= 0 && unsynced > 0) {
+        fsync(fd);
+        unsynced = 0;
+    }
+}
+
+/*
+ * Syncs and closes the file.
+ */
+void RecordWriter::close() {
+    sync();
+    std::lock_guard<std::mutex> guard(lock);
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
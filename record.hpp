@@ -0,0 +1,54 @@
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "common.hpp"
+
+// What a record's score is measured in
+#define RECORD_SCORE_EVAL (0)       // evaluator units
+#define RECORD_SCORE_DISCS (1)      // a proven final disc difference
+
+/*
+ * One labeled position from a game, as stored in training data files. Records
+ * are fixed size and written in native (little-endian) byte order so a file
+ * can be read back with plain reads or mapped straight into memory.
+ */
+struct PositionRecord {
+    uint64_t black;         // squares held by black, bit x + 8*y
+    uint64_t white;         // squares held by white, bit x + 8*y
+    uint8_t side;           // side to move, as a Side value
+    int8_t move;            // square played, x + 8*y, or -1 for a pass
+    int16_t score;          // search score from the side to move's view
+    int8_t result;          // final black minus white disc count
+    uint8_t scoreKind;      // RECORD_SCORE_EVAL or RECORD_SCORE_DISCS
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(PositionRecord) == 24, "PositionRecord must stay 24 bytes");
+
+/*
+ * Appends records to a data file. Writes from several threads are serialized,
+ * and the file is fsync'ed every syncEvery records so a crash loses at most
+ * that many.
+ */
+class RecordWriter {
+
+public:
+    RecordWriter();
+    ~RecordWriter();
+
+    bool open(const char *path, size_t syncEvery);
+    bool write(const PositionRecord *records, size_t count);
+    void sync();
+    void close();
+
+private:
+    int fd;
+    size_t syncEvery;
+    size_t unsynced;
+    std::mutex lock;
+};
+
+#endif
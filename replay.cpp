@@ -0,0 +1,166 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <unistd.h>
+#include "player.hpp"
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Reruns the searches recorded in a trace (QWERTY_TRACE=<file> on qwerty)
+ * and checks that each one reaches the same node counts, scores and moves.
+ * Reports the time each replay took, so that a slow move from a real game can
+ * be rerun as often as needed under a profiler. Exits non-zero if any replay
+ * diverges from its trace.
+ *
+ * If the traced player had a transposition table, each timed replay starts
+ * from a table that has seen exactly the earlier moves of the trace, which
+ * are replayed (untimed) first whenever the table is not already in that
+ * state.
+ */
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-m move] [-n repeat] trace" << endl;
+    cerr << "  -m  replay only this move of the trace, counting from 0" << endl;
+    cerr << "  -n  replay each move this many times" << endl;
+    exit(-1);
+}
+
+static string squareName(int square) {
+    if (square < 0) return "pass";
+    return string(1, (char) ('a' + square % BOARD_SIZE)) + to_string(square / BOARD_SIZE + 1);
+}
+
+/*
+ * Returns a description of the first difference between a trace and its
+ * replay, or an empty string if there is none.
+ */
+static string compare(const TraceMove &recorded, const TraceMove &replayed) {
+    size_t count = max(recorded.checkpoints.size(), replayed.checkpoints.size());
+    for (size_t i = 0; i < count; i++) {
+        if (i >= recorded.checkpoints.size() || i >= replayed.checkpoints.size()) {
+            return "checkpoint count " + to_string(replayed.checkpoints.size())
+                + ", expected " + to_string(recorded.checkpoints.size());
+        }
+        const TraceCheckpoint &a = recorded.checkpoints[i];
+        const TraceCheckpoint &b = replayed.checkpoints[i];
+        if (a.depth != b.depth || a.nodes != b.nodes || a.score != b.score || a.move != b.move) {
+            return "depth " + to_string(b.depth) + " nodes " + to_string(b.nodes)
+                + " score " + to_string(b.score) + " move " + squareName(b.move)
+                + ", expected depth " + to_string(a.depth) + " nodes " + to_string(a.nodes)
+                + " score " + to_string(a.score) + " move " + squareName(a.move);
+        }
+    }
+    if (recorded.aborts != replayed.aborts) {
+        return "stopped " + to_string(replayed.aborts.size()) + " searches, expected "
+            + to_string(recorded.aborts.size());
+    }
+    if (recorded.nodes != replayed.nodes || recorded.move != replayed.move) {
+        return "nodes " + to_string(replayed.nodes) + " move " + squareName(replayed.move)
+            + ", expected nodes " + to_string(recorded.nodes) + " move " + squareName(recorded.move);
+    }
+    return "";
+}
+
+int main(int argc, char *argv[]) {
+    int only = -1;
+    int repeat = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:")) != -1) {
+        switch (opt) {
+            case 'm': only = atoi(optarg); break;
+            case 'n': repeat = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1 || repeat < 1) usage(argv[0]);
+
+    TraceReader reader;
+    if (!reader.open(argv[optind])) {
+        cerr << "replay: cannot read trace " << argv[optind] << endl;
+        exit(-1);
+    }
+
+    vector<TraceMove> moves;
+    TraceMove next;
+    while (reader.next(next)) {
+        moves.push_back(next);
+    }
+
+    cout << fixed << setprecision(3);
+    int replayed = 0, mismatches = 0;
+    // The tables and how many moves of the trace they have seen
+    TranspositionTable *table = nullptr;
+    EndgameTable *endgameTable = nullptr;
+    int warmed = 0;
+    for (int index = 0; index < (int) moves.size(); index++) {
+        if (only >= 0 && index != only) continue;
+        const TraceMove &recorded = moves[index];
+
+        Board start;
+        start.setBits(recorded.black, recorded.white);
+        cout << "move " << index << ": " << formatPosition(&start, (Side) recorded.side)
+             << " msLeft " << recorded.msLeft << ", " << recorded.iterations << " iterations, "
+             << recorded.aborts.size() << " stopped, " << recorded.nodes << " nodes, played "
+             << squareName(recorded.move) << endl;
+
+        for (int r = 0; r < repeat; r++) {
+            bool tables = recorded.ttEntries > 0 || recorded.endgameEntries > 0;
+            if (tables && ((table == nullptr && endgameTable == nullptr) || warmed != index)) {
+                delete table;
+                delete endgameTable;
+                table = nullptr;
+                endgameTable = nullptr;
+                if (recorded.ttEntries > 0) {
+                    table = new TranspositionTable(recorded.ttEntries * sizeof(TTEntry));
+                }
+                if (recorded.endgameEntries > 0) {
+                    endgameTable = new EndgameTable(recorded.endgameEntries * sizeof(EndgameEntry));
+                }
+                if ((table != nullptr && table->size() != recorded.ttEntries)
+                        || (endgameTable != nullptr
+                            && endgameTable->size() != recorded.endgameEntries)) {
+                    cerr << "replay: cannot allocate tables of " << recorded.ttEntries << " and "
+                         << recorded.endgameEntries << " entries" << endl;
+                    exit(-1);
+                }
+                for (warmed = 0; warmed < index; warmed++) {
+                    Player earlier((Side) moves[warmed].side);
+                    earlier.setTranspositionTable(table);
+                    earlier.setEndgameTable(endgameTable);
+                    delete earlier.replay(moves[warmed]);
+                }
+            }
+
+            Player player((Side) recorded.side);
+            if (recorded.ttEntries > 0) player.setTranspositionTable(table);
+            if (recorded.endgameEntries > 0) player.setEndgameTable(endgameTable);
+            chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+            delete player.replay(recorded);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            warmed = index + 1;
+
+            string difference = compare(recorded, player.getLastTrace());
+            cout << "  replay " << r << ": " << seconds << " s, "
+                 << (long long) (player.getLastTrace().nodes / max(seconds, 1e-9)) << " nodes/s";
+            if (difference.empty()) {
+                cout << " ok" << endl;
+            } else {
+                cout << " MISMATCH: " << difference << endl;
+                mismatches++;
+            }
+        }
+        replayed++;
+    }
+
+    if (only >= 0 && replayed == 0) {
+        cerr << "replay: trace has no move " << only << endl;
+        exit(-1);
+    }
+    delete table;
+    delete endgameTable;
+    cout << "total: " << replayed << " moves replayed, " << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
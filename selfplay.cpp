@@ -0,0 +1,193 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "game.hpp"
+#include "record.hpp"
+using namespace std;
+
+/*
+ * Settings shared by every self-play worker.
+ */
+struct SelfPlayConfig {
+    int games;
+    int threads;
+    int depth;
+    int msPerGame;
+    int randomPlies;
+    unsigned int seed;
+    size_t syncEvery;
+    size_t ttMB;            // each player's transposition table, 0 for none
+};
+
+static SelfPlayConfig config;
+static RecordWriter writer;
+static atomic<int> nextGame(0);
+static atomic<int> gamesDone(0);
+static atomic<long long> positionsDone(0);
+static mutex reportLock;
+static chrono::steady_clock::time_point startTime;
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-g games] [-j threads] [-d depth]"
+         << " [-m msPerGame] [-r randomPlies] [-s seed] [-f syncEvery]"
+         << " [-t ttMB] output" << endl;
+    exit(-1);
+}
+
+static double hoursSince(chrono::steady_clock::time_point t) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t).count() / 3600.0;
+}
+
+/*
+ * Plays one engine-vs-engine game and appends its positions to records. Both
+ * engines search with the configured depth and, if set, a per-game clock
+ * kept the same way OthelloGame keeps it. Each has its own tables, fresh
+ * for the game, as two qwerty processes would.
+ */
+static void playSelfPlayGame(int gameIndex, vector<PositionRecord> &records) {
+    mt19937 rng(config.seed + gameIndex);
+    Board board;
+    Side turn = applyOpening(&board, randomOpening(config.randomPlies, rng));
+
+    Player blackPlayer(BLACK);
+    Player whitePlayer(WHITE);
+    TranspositionTable *tables[2] = { nullptr, nullptr };
+    EndgameTable *endgameTables[2];
+    for (int side = 0; side < 2; side++) {
+        if (config.ttMB > 0) tables[side] = new TranspositionTable(config.ttMB << 20);
+        endgameTables[side] = new EndgameTable(ENDGAME_TT_BYTES);
+    }
+    blackPlayer.setTranspositionTable(tables[BLACK]);
+    whitePlayer.setTranspositionTable(tables[WHITE]);
+    blackPlayer.setEndgameTable(endgameTables[BLACK]);
+    whitePlayer.setEndgameTable(endgameTables[WHITE]);
+    blackPlayer.setBoard(board.copy());
+    whitePlayer.setBoard(board.copy());
+    blackPlayer.setSearchDepth(config.depth);
+    whitePlayer.setSearchDepth(config.depth);
+    long usLeft[2] = { config.msPerGame * 1000L, config.msPerGame * 1000L };
+
+    records.clear();
+    Move *lastMove = nullptr;
+    while (!board.isDone()) {
+        Player *player = (turn == BLACK) ? &blackPlayer : &whitePlayer;
+        PositionRecord record;
+        memset(&record, 0, sizeof(record));
+        record.black = board.getBits(BLACK);
+        record.white = board.getBits(WHITE);
+        record.side = turn;
+
+        // The clock runs in microseconds so that fast moves are charged. An
+        // engine that has used up its clock still gets 1 ms per move, as a
+        // non-positive msLeft would mean no limit at all.
+        chrono::steady_clock::time_point moveStart = chrono::steady_clock::now();
+        int clock = (config.msPerGame > 0) ? max(usLeft[turn] / 1000, 1L) : -1;
+        Move *move = player->doMove(lastMove, clock);
+        usLeft[turn] -= chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - moveStart).count();
+
+        // Forced passes carry no information, so only real moves are kept.
+        if (move != nullptr) {
+            board.doMove(move, turn);
+            const SearchStats &stats = player->getLastStats();
+            record.move = move->getX() + 8 * move->getY();
+            record.score = max(-32768, min(32767, stats.score));
+            record.scoreKind = stats.proven ? RECORD_SCORE_DISCS : RECORD_SCORE_EVAL;
+            records.push_back(record);
+        }
+
+        delete lastMove;
+        lastMove = move;
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    delete lastMove;
+
+    for (int side = 0; side < 2; side++) {
+        delete tables[side];
+        delete endgameTables[side];
+    }
+
+    int result = board.countBlack() - board.countWhite();
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i].result = result;
+    }
+}
+
+/*
+ * Worker thread body; claims game numbers until the requested count is met.
+ */
+static void worker() {
+    vector<PositionRecord> records;
+    int gameIndex;
+    while ((gameIndex = nextGame++) < config.games) {
+        playSelfPlayGame(gameIndex, records);
+        if (!writer.write(records.data(), records.size())) {
+            cerr << "selfplay: write failed" << endl;
+            exit(-1);
+        }
+
+        positionsDone += records.size();
+        int done = ++gamesDone;
+        if (done % 100 == 0) {
+            lock_guard<mutex> guard(reportLock);
+            cerr << done << " games, " << positionsDone << " positions, "
+                 << (long long) (done / hoursSince(startTime)) << " games/hour" << endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    config.games = 1000;
+    config.threads = thread::hardware_concurrency();
+    config.depth = 4;
+    config.msPerGame = -1;
+    config.randomPlies = 8;
+    config.seed = 1;
+    config.syncEvery = 100000;
+    config.ttMB = DEFAULT_TT_MB;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "g:j:d:m:r:s:f:t:")) != -1) {
+        switch (opt) {
+            case 'g': config.games = atoi(optarg); break;
+            case 'j': config.threads = atoi(optarg); break;
+            case 'd': config.depth = atoi(optarg); break;
+            case 'm': config.msPerGame = atoi(optarg); break;
+            case 'r': config.randomPlies = atoi(optarg); break;
+            case 's': config.seed = strtoul(optarg, nullptr, 10); break;
+            case 'f': config.syncEvery = strtoul(optarg, nullptr, 10); break;
+            case 't': config.ttMB = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1 || config.depth < 1) usage(argv[0]);
+    if (config.threads < 1) config.threads = 1;
+
+    if (!writer.open(argv[optind], config.syncEvery)) {
+        cerr << "selfplay: cannot open " << argv[optind] << endl;
+        exit(-1);
+    }
+
+    startTime = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < config.threads; i++) {
+        threads.push_back(thread(worker));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    writer.close();
+
+    double hours = hoursSince(startTime);
+    cout << gamesDone << " games, " << positionsDone << " positions in "
+         << hours * 3600.0 << " s (" << (long long) (gamesDone / hours)
+         << " games/hour, " << config.threads << " threads)" << endl;
+    return 0;
+}
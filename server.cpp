@@ -0,0 +1,323 @@
+#include <iostream>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Plays many games at once over a Unix domain socket. Every connection is
+ * one game and speaks the wrapper.cpp protocol, preceded by a line with the
+ * arguments qwerty would have been started with ("Black" or "White", then
+ * optionally an opening):
+ *
+ *   -> Black f5d6
+ *   <- Init done
+ *   -> -1 -1 60000
+ *   <- 2 3
+ *
+ * One I/O thread polls every connection and hands each complete request line
+ * to a fixed pool of worker threads; a game has at most one request in
+ * flight, so its Player is only ever used by one worker at a time. All games
+ * share the same settings and, if asked for, one transposition table.
+ *
+ * Games waiting for a free worker still have their clocks running, so the
+ * pool should be about as large as the number of cores the server may use.
+ */
+
+/*
+ * State of one connection.
+ */
+struct Game {
+    int fd;
+    // Bytes read but not yet part of a complete line
+    string buffer;
+    // The line a worker is handling
+    string request;
+    // Created by the first line of the connection
+    Player *player;
+    // A worker holds the game; the I/O thread leaves it alone until it is
+    // handed back
+    bool busy;
+    // The peer hung up or broke the protocol
+    bool closed;
+};
+
+static EngineConfig config;
+static TranspositionTable *table = nullptr;
+static EndgameTable *endgameTable = nullptr;
+
+static mutex jobsLock;
+static condition_variable jobsReady;
+static deque<Game*> jobs;
+static mutex doneLock;
+static vector<Game*> done;
+static int wakeFds[2];
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-j workers] [-c ttMB] [-x config] socket" << endl;
+    cerr << "config is a key=value list, e.g. depth=6,eval=discs; -c (or tt=MB)"
+         << " shares one transposition table, and an endgame table, between all games" << endl;
+    exit(-1);
+}
+
+/*
+ * Writes a whole reply to a game. Returns false if the peer has gone.
+ */
+static bool reply(Game *game, const string &data) {
+    const char *next = data.c_str();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t written = send(game->fd, next, left, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        next += written;
+        left -= written;
+    }
+    return true;
+}
+
+/*
+ * Handles one request line: the setup line if the game has no player yet,
+ * otherwise a move.
+ */
+static void handle(Game *game) {
+    const string &line = game->request;
+    if (game->player == nullptr) {
+        char side[16], openingText[256];
+        vector<int> opening;
+        int fields = sscanf(line.c_str(), "%15s %255s", side, openingText);
+        if (fields < 1 || (strcmp(side, "Black") && strcmp(side, "White"))
+                || (fields == 2 && !parseOpening(openingText, opening))) {
+            game->closed = true;
+            return;
+        }
+        Player *player = new Player(!strcmp(side, "Black") ? BLACK : WHITE);
+        player->testingMinimax = config.discEval;
+        player->setSearchDepth(config.depth);
+        player->setEndgameEmpties(config.endgameEmpties);
+        player->setInternalDeepening(config.iidDepth, config.iidReduction);
+        player->setEvaluators(config.leafEval, config.orderEval);
+        player->setTranspositionTable(table);
+        player->setEndgameTable(endgameTable);
+        Board *board = new Board();
+        applyOpening(board, opening);
+        player->setBoard(board);
+        game->player = player;
+        game->closed = !reply(game, "Init done\n");
+        return;
+    }
+
+    int moveX, moveY, msLeft;
+    if (sscanf(line.c_str(), "%d %d %d", &moveX, &moveY, &msLeft) != 3
+            || moveX >= BOARD_SIZE || moveY >= BOARD_SIZE) {
+        game->closed = true;
+        return;
+    }
+    Move *opponentsMove = nullptr;
+    if (moveX >= 0 && moveY >= 0) {
+        opponentsMove = new Move(moveX, moveY);
+    }
+    Move *playersMove = game->player->doMove(opponentsMove, msLeft);
+    string answer = "-1 -1\n";
+    if (playersMove != nullptr) {
+        answer = to_string(playersMove->getX()) + " " + to_string(playersMove->getY()) + "\n";
+    }
+    delete opponentsMove;
+    delete playersMove;
+    game->closed = !reply(game, answer);
+}
+
+/*
+ * Worker thread body; handles requests forever and hands each game back to
+ * the I/O thread when its request is done.
+ */
+static void worker() {
+    while (true) {
+        Game *game;
+        {
+            unique_lock<mutex> guard(jobsLock);
+            jobsReady.wait(guard, []() { return !jobs.empty(); });
+            game = jobs.front();
+            jobs.pop_front();
+        }
+        handle(game);
+        {
+            lock_guard<mutex> guard(doneLock);
+            done.push_back(game);
+        }
+        char wake = 0;
+        while (write(wakeFds[1], &wake, 1) < 0 && errno == EINTR) {}
+    }
+}
+
+/*
+ * Passes the game's next complete line to a worker, if it has one and is not
+ * already being worked on.
+ */
+static void dispatch(Game *game) {
+    size_t newline = game->buffer.find('\n');
+    if (game->busy || game->closed || newline == string::npos) return;
+    game->request = game->buffer.substr(0, newline);
+    if (!game->request.empty() && game->request[game->request.size() - 1] == '\r') {
+        game->request.erase(game->request.size() - 1);
+    }
+    game->buffer.erase(0, newline + 1);
+    game->busy = true;
+    {
+        lock_guard<mutex> guard(jobsLock);
+        jobs.push_back(game);
+    }
+    jobsReady.notify_one();
+}
+
+static int listenOn(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    // A socket left behind by a previous server is replaced; anything else
+    // at the path is not touched.
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    int workers = thread::hardware_concurrency();
+    config.ttMB = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:c:x:")) != -1) {
+        switch (opt) {
+            case 'j': workers = atoi(optarg); break;
+            case 'c': config.ttMB = strtoul(optarg, nullptr, 10); break;
+            case 'x':
+                if (!config.parse(optarg)) usage(argv[0]);
+                break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1) usage(argv[0]);
+    if (workers < 1) workers = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    int listenFd = listenOn(argv[optind]);
+    if (listenFd < 0) {
+        cerr << "server: cannot listen on " << argv[optind] << ": " << strerror(errno) << endl;
+        exit(-1);
+    }
+    if (pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK) < 0) {
+        cerr << "server: cannot create pipe" << endl;
+        exit(-1);
+    }
+    if (config.ttMB > 0) {
+        table = new TranspositionTable(config.ttMB << 20);
+        endgameTable = new EndgameTable(ENDGAME_TT_BYTES);
+    }
+
+    vector<thread> pool;
+    for (int i = 0; i < workers; i++) {
+        pool.push_back(thread(worker));
+    }
+    cerr << "server: listening on " << argv[optind] << " with " << workers << " workers, "
+         << config.toString() << endl;
+
+    vector<Game*> games;
+    vector<struct pollfd> fds;
+    vector<Game*> polled;
+    while (true) {
+        fds.clear();
+        polled.clear();
+        struct pollfd wake = { wakeFds[0], POLLIN, 0 };
+        struct pollfd listener = { listenFd, POLLIN, 0 };
+        fds.push_back(wake);
+        fds.push_back(listener);
+        for (size_t i = 0; i < games.size(); i++) {
+            if (games[i]->busy) continue;
+            struct pollfd pfd = { games[i]->fd, POLLIN, 0 };
+            fds.push_back(pfd);
+            polled.push_back(games[i]);
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            cerr << "server: poll failed: " << strerror(errno) << endl;
+            exit(-1);
+        }
+
+        // Games handed back by the workers can take their next request.
+        if (fds[0].revents) {
+            char drain[64];
+            while (read(wakeFds[0], drain, sizeof(drain)) > 0) {}
+            lock_guard<mutex> guard(doneLock);
+            for (size_t i = 0; i < done.size(); i++) {
+                done[i]->busy = false;
+                dispatch(done[i]);
+            }
+            done.clear();
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                Game *game = new Game();
+                game->fd = fd;
+                game->player = nullptr;
+                game->busy = false;
+                game->closed = false;
+                games.push_back(game);
+            }
+        }
+
+        for (size_t i = 0; i < polled.size(); i++) {
+            if (fds[i + 2].revents == 0) continue;
+            Game *game = polled[i];
+            char chunk[256];
+            ssize_t got = read(game->fd, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) {
+                game->closed = true;
+                continue;
+            }
+            game->buffer.append(chunk, got);
+            dispatch(game);
+        }
+
+        // Games that are finished and not held by a worker are dropped.
+        for (size_t i = 0; i < games.size(); ) {
+            Game *game = games[i];
+            if (!game->busy && game->closed) {
+                close(game->fd);
+                delete game->player;
+                delete game;
+                games[i] = games.back();
+                games.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include "game.hpp"
+using namespace std;
+
+/*
+ * Sequential probability ratio test between a candidate engine (A) and a
+ * baseline (B). Games are played in pairs from the same opening with colors
+ * swapped; each pair's result (0, 0.5, ..., 2 points for A) is tallied in a
+ * pentanomial histogram, which is what the Elo estimate and the log
+ * likelihood ratio are computed from. The test stops as soon as the LLR
+ * leaves [log(beta / (1 - alpha)), log((1 - beta) / alpha)].
+ */
+
+struct SprtSettings {
+    double elo0, elo1;
+    double alpha, beta;
+    int maxPairs;
+    long msPerGame;
+    unsigned int seed;
+};
+
+static SprtSettings settings;
+static string specs[2];
+static vector<vector<int> > openings;
+static vector<size_t> openingOrder;
+
+static atomic<int> nextPair(0);
+static atomic<bool> finished(false);
+static mutex statsLock;
+static long long penta[5];
+static int wins, losses, draws, errors[2];
+static int pairsDone;
+static int verdict;
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-o openings] [-j threads] [-t msPerGame]"
+         << " [-n maxPairs] [-e elo0] [-E elo1] [-a alpha] [-b beta] [-s seed]"
+         << " candidate baseline" << endl;
+    cerr << "engines are key=value lists, e.g. depth=6,eval=discs, or"
+         << " cmd:<command> for an engine binary, or unix:<path> for an engine server" << endl;
+    exit(-1);
+}
+
+static double expectedScore(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double eloFromScore(double score) {
+    score = max(1e-6, min(1.0 - 1e-6, score));
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+/*
+ * Mean and variance of the per-game score of A, measured per pair.
+ */
+static void pairMoments(double &mean, double &variance) {
+    mean = variance = 0.0;
+    if (pairsDone == 0) return;
+    for (int i = 0; i < 5; i++) {
+        mean += penta[i] * (i / 4.0);
+    }
+    mean /= pairsDone;
+    for (int i = 0; i < 5; i++) {
+        variance += penta[i] * (i / 4.0 - mean) * (i / 4.0 - mean);
+    }
+    variance /= pairsDone;
+}
+
+/*
+ * Generalized SPRT log likelihood ratio of H1 (elo1) against H0 (elo0) under
+ * the normal approximation of the pair scores.
+ */
+static double llr() {
+    double mean, variance;
+    pairMoments(mean, variance);
+    if (variance <= 0.0) return 0.0;
+    double s0 = expectedScore(settings.elo0);
+    double s1 = expectedScore(settings.elo1);
+    return pairsDone * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+}
+
+static void printStatus(ostream &out) {
+    double mean, variance;
+    pairMoments(mean, variance);
+    double margin = 1.96 * sqrt(variance / max(pairsDone, 1));
+    double elo = eloFromScore(mean);
+    double lower = log(settings.beta / (1.0 - settings.alpha));
+    double upper = log((1.0 - settings.beta) / settings.alpha);
+
+    out << 2 * pairsDone << " games: " << wins << "W " << losses << "L "
+        << draws << "D, penta [" << penta[0] << " " << penta[1] << " "
+        << penta[2] << " " << penta[3] << " " << penta[4] << "]" << endl;
+    out << "Elo " << elo << " +/- " << (eloFromScore(mean + margin) - eloFromScore(mean - margin)) / 2.0
+        << " (95%), LLR " << llr() << " [" << lower << ", " << upper << "]"
+        << ", errors A " << errors[0] << " B " << errors[1] << endl;
+}
+
+/*
+ * Plays one game and returns A's points doubled (0, 1 or 2).
+ */
+static int playOne(Engine *a, Engine *b, bool aIsBlack, const vector<int> &opening) {
+    GameResult r = aIsBlack ? playGame(a, b, opening, settings.msPerGame)
+                            : playGame(b, a, opening, settings.msPerGame);
+    int outcome = aIsBlack ? r.winner() : -r.winner();
+
+    lock_guard<mutex> guard(statsLock);
+    if (r.conclusion == BLACK_ERROR_CONCLUSION) errors[aIsBlack ? 0 : 1]++;
+    if (r.conclusion == WHITE_ERROR_CONCLUSION) errors[aIsBlack ? 1 : 0]++;
+    if (outcome > 0) wins++;
+    else if (outcome < 0) losses++;
+    else draws++;
+    return outcome + 1;
+}
+
+/*
+ * Worker thread body; plays pairs until the test reaches a decision or the
+ * pair limit.
+ */
+static void worker() {
+    Engine *a = createEngine(specs[0]);
+    Engine *b = createEngine(specs[1]);
+    int pair;
+    while (!finished && (pair = nextPair++) < settings.maxPairs) {
+        const vector<int> &opening = openings[openingOrder[pair % openings.size()]];
+        int points = playOne(a, b, true, opening) + playOne(a, b, false, opening);
+
+        lock_guard<mutex> guard(statsLock);
+        penta[points]++;
+        pairsDone++;
+        double ratio = llr();
+        if (!finished && ratio >= log((1.0 - settings.beta) / settings.alpha)) {
+            verdict = 1;
+            finished = true;
+        } else if (!finished && ratio <= log(settings.beta / (1.0 - settings.alpha))) {
+            verdict = -1;
+            finished = true;
+        }
+        if (pairsDone % 50 == 0) printStatus(cerr);
+    }
+    delete a;
+    delete b;
+}
+
+int main(int argc, char *argv[]) {
+    settings.elo0 = 0.0;
+    settings.elo1 = 10.0;
+    settings.alpha = 0.05;
+    settings.beta = 0.05;
+    settings.maxPairs = 20000;
+    settings.msPerGame = -1;
+    settings.seed = 1;
+    const char *openingFile = "openings.txt";
+    int threads = thread::hardware_concurrency();
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:j:t:n:e:E:a:b:s:")) != -1) {
+        switch (opt) {
+            case 'o': openingFile = optarg; break;
+            case 'j': threads = atoi(optarg); break;
+            case 't': settings.msPerGame = atol(optarg); break;
+            case 'n': settings.maxPairs = atoi(optarg); break;
+            case 'e': settings.elo0 = atof(optarg); break;
+            case 'E': settings.elo1 = atof(optarg); break;
+            case 'a': settings.alpha = atof(optarg); break;
+            case 'b': settings.beta = atof(optarg); break;
+            case 's': settings.seed = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 2 || settings.elo1 <= settings.elo0
+            || settings.alpha <= 0.0 || settings.beta <= 0.0) {
+        usage(argv[0]);
+    }
+    for (int e = 0; e < 2; e++) {
+        specs[e] = argv[optind + e];
+        Engine *engine = createEngine(specs[e]);
+        if (engine == nullptr) {
+            cerr << "sprt: bad engine " << specs[e] << endl;
+            usage(argv[0]);
+        }
+        delete engine;
+    }
+    if (!loadOpenings(openingFile, openings) || openings.empty()) {
+        cerr << "sprt: cannot read openings from " << openingFile << endl;
+        exit(-1);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    if (threads < 1) threads = 1;
+
+    // Walk the openings in a seeded random order so that a short test is not
+    // biased towards whatever the file happens to start with.
+    for (size_t i = 0; i < openings.size(); i++) {
+        openingOrder.push_back(i);
+    }
+    mt19937 rng(settings.seed);
+    shuffle(openingOrder.begin(), openingOrder.end(), rng);
+
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread(worker));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+
+    printStatus(cout);
+    if (verdict > 0) {
+        cout << "H1 accepted: candidate is at least " << settings.elo1 << " Elo stronger" << endl;
+    } else if (verdict < 0) {
+        cout << "H0 accepted: candidate is not " << settings.elo1 << " Elo stronger" << endl;
+    } else {
+        cout << "No decision after " << pairsDone << " pairs" << endl;
+    }
+    return verdict < 0 ? 1 : 0;
+}
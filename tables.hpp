@@ -0,0 +1,164 @@
+#ifndef __TABLES_H__
+#define __TABLES_H__
+
+#include <cstdint>
+#include "common.hpp"
+#include "board.hpp"
+
+/*
+ * Lookup tables for the board kernels. They are generated by constexpr
+ * functions while compiling, so they sit in read-only data ready to use:
+ * nothing is computed at startup and no static initialization order is
+ * involved. The static_asserts at the end check a few known values whenever
+ * this header is compiled.
+ *
+ * Every table exists per board size N, with squares numbered x + N*y, the
+ * same as BasicBoard<N>::getBits.
+ */
+
+// The eight directions, as steps in x and y. The first four move to higher
+// square numbers, the last four to lower ones.
+enum Direction {
+    DIR_E, DIR_SW, DIR_S, DIR_SE, DIR_W, DIR_NE, DIR_N, DIR_NW, DIR_COUNT
+};
+constexpr int DIRECTION_DX[DIR_COUNT] = { 1, -1, 0, 1, -1, 1, 0, -1 };
+constexpr int DIRECTION_DY[DIR_COUNT] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+/*
+ * Whether a direction moves to higher square numbers, in which case the
+ * nearest square of a ray is its lowest set bit.
+ */
+constexpr bool ascending(int direction) {
+    return direction < DIR_W;
+}
+
+/*
+ * The squares reached by stepping from (x, y) in a direction until the edge,
+ * not counting (x, y) itself.
+ */
+template <int N>
+constexpr BoardBits<N> rayMask(int x, int y, int direction) {
+    BoardBits<N> mask = 0;
+    x += DIRECTION_DX[direction];
+    y += DIRECTION_DY[direction];
+    while (0 <= x && x < N && 0 <= y && y < N) {
+        mask |= (BoardBits<N>) 1 << (x + N * y);
+        x += DIRECTION_DX[direction];
+        y += DIRECTION_DY[direction];
+    }
+    return mask;
+}
+
+/*
+ * Which kind of square (x, y) is for the weighted evaluation.
+ */
+template <int N>
+constexpr Position squarePosition(int x, int y) {
+    bool xEnd = (x == 0 || x == N - 1);
+    bool yEnd = (y == 0 || y == N - 1);
+    bool xNext = (x == 1 || x == N - 2);
+    bool yNext = (y == 1 || y == N - 2);
+    if (xEnd && yEnd) return CORNER;
+    if (xNext && yNext) return DIAGONAL_TO_CORNER;
+    if ((xEnd && yNext) || (xNext && yEnd)) return NEXT_TO_CORNER;
+    if (xEnd || yEnd) return EDGE;
+    return OTHER;
+}
+
+template <int N>
+struct RayTable {
+    BoardBits<N> masks[N * N][DIR_COUNT];
+};
+
+template <int N>
+constexpr RayTable<N> makeRayTable() {
+    RayTable<N> table = {};
+    for (int square = 0; square < N * N; square++) {
+        for (int direction = 0; direction < DIR_COUNT; direction++) {
+            table.masks[square][direction] = rayMask<N>(square % N, square / N, direction);
+        }
+    }
+    return table;
+}
+
+template <int N>
+struct PositionTable {
+    Position squares[N * N];
+    // Every square of each kind, indexed by Position
+    BoardBits<N> masks[OTHER + 1];
+};
+
+template <int N>
+constexpr PositionTable<N> makePositionTable() {
+    PositionTable<N> table = {};
+    for (int square = 0; square < N * N; square++) {
+        Position pos = squarePosition<N>(square % N, square / N);
+        table.squares[square] = pos;
+        table.masks[pos] |= (BoardBits<N>) 1 << square;
+    }
+    return table;
+}
+
+/*
+ * How far a bitboard shifts to move every disc one step in each direction,
+ * and the squares such a step can land on: those whose neighbour back against
+ * the direction is on the board, so that nothing wraps around an edge or
+ * lands past the last square.
+ */
+template <int N>
+struct ShiftTable {
+    int amounts[DIR_COUNT];
+    BoardBits<N> masks[DIR_COUNT];
+    // Every square of the board
+    BoardBits<N> board;
+};
+
+template <int N>
+constexpr ShiftTable<N> makeShiftTable() {
+    ShiftTable<N> table = {};
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        int dx = DIRECTION_DX[direction];
+        int dy = DIRECTION_DY[direction];
+        table.amounts[direction] = dx + N * dy;
+        for (int square = 0; square < N * N; square++) {
+            int x = square % N - dx;
+            int y = square / N - dy;
+            if (0 <= x && x < N && 0 <= y && y < N) {
+                table.masks[direction] |= (BoardBits<N>) 1 << square;
+            }
+        }
+    }
+    for (int square = 0; square < N * N; square++) {
+        table.board |= (BoardBits<N>) 1 << square;
+    }
+    return table;
+}
+
+template <int N> constexpr RayTable<N> RAYS = makeRayTable<N>();
+template <int N> constexpr PositionTable<N> POSITIONS = makePositionTable<N>();
+template <int N> constexpr ShiftTable<N> SHIFTS = makeShiftTable<N>();
+
+static_assert(RAYS<8>.masks[0][DIR_E] == 0x00000000000000FEULL, "a1 east is the rest of row 1");
+static_assert(RAYS<8>.masks[0][DIR_SE] == 0x8040201008040200ULL, "a1 along the long diagonal");
+static_assert(RAYS<8>.masks[63][DIR_N] == 0x0080808080808080ULL, "h8 back up column h");
+static_assert(RAYS<8>.masks[7][DIR_SW] == 0x0102040810204000ULL, "h1 along the other diagonal");
+static_assert(RAYS<8>.masks[27][DIR_NW] == 0x0000000000040201ULL, "d4 toward a1");
+static_assert(RAYS<8>.masks[56][DIR_S] == 0, "nothing past the last row");
+static_assert(POSITIONS<8>.masks[CORNER] == 0x8100000000000081ULL, "the four corners");
+static_assert(POSITIONS<8>.masks[DIAGONAL_TO_CORNER] == 0x0042000000004200ULL, "the X-squares");
+static_assert(POSITIONS<8>.masks[NEXT_TO_CORNER] == 0x4281000000008142ULL, "the C-squares");
+static_assert((POSITIONS<8>.masks[CORNER] | POSITIONS<8>.masks[EDGE]
+        | POSITIONS<8>.masks[NEXT_TO_CORNER] | POSITIONS<8>.masks[DIAGONAL_TO_CORNER]
+        | POSITIONS<8>.masks[OTHER]) == ~0ULL, "every square has a kind");
+static_assert(RAYS<10>.masks[0][DIR_E] == 0x3FE, "a1 east on 10x10 crosses into no other row");
+static_assert(RAYS<10>.masks[99][DIR_N] >> 64 == 0x0000000002008020ULL,
+        "j10 up column j reaches past the first word");
+static_assert(POSITIONS<10>.squares[11] == DIAGONAL_TO_CORNER, "b2 is an X-square on 10x10");
+static_assert(SHIFTS<8>.amounts[DIR_SW] == 7 && SHIFTS<8>.amounts[DIR_NW] == -9,
+        "steps are x + 8*y");
+static_assert(SHIFTS<8>.masks[DIR_E] == 0xFEFEFEFEFEFEFEFEULL, "an east step never lands on column a");
+static_assert(SHIFTS<8>.masks[DIR_NE] == 0x00FEFEFEFEFEFEFEULL, "nor does a north-east one, or row 8");
+static_assert(SHIFTS<8>.board == ~0ULL, "8x8 fills the word");
+static_assert(SHIFTS<10>.board >> 64 == 0xFFFFFFFFFULL, "10x10 uses 36 bits of the second word");
+
+#endif
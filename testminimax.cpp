@@ -26,6 +26,7 @@ int main(int argc, char *argv[]) {
     // Initialize player as the white player, and set testing_minimax flag.
     Player *player = new Player(WHITE);
     player->testingMinimax = true;
+    player->setSearchDepth(2);
     
     
     player->setBoard(board);
@@ -45,5 +46,39 @@ int main(int argc, char *argv[]) {
         std::cout << ", expected (1, 1)" << std::endl;
     }
 
+    // White's only move here is e7 (4, 6). It is played without a search,
+    // but its score should still be that of the 2-ply search, not 0.
+    char forcedData[64] = {
+        ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+        ' ', 'w', ' ', 'w', ' ', ' ', ' ', ' ',
+        ' ', ' ', ' ', ' ', 'w', ' ', ' ', ' ',
+        ' ', ' ', ' ', ' ', 'b', ' ', ' ', ' ',
+        ' ', ' ', ' ', ' ', 'w', ' ', ' ', ' ',
+        ' ', ' ', ' ', ' ', 'b', ' ', ' ', ' ',
+        ' ', ' ', ' ', 'b', ' ', 'b', 'w', ' ',
+        'b', ' ', ' ', ' ', ' ', ' ', 'b', ' '
+    };
+
+    Board *forcedBoard = new Board();
+    forcedBoard->setBoard(forcedData);
+    Player *forcedPlayer = new Player(WHITE);
+    forcedPlayer->testingMinimax = true;
+    forcedPlayer->setSearchDepth(2);
+    forcedPlayer->setBoard(forcedBoard);
+
+    Move *forced = forcedPlayer->doMove(nullptr, 0);
+    int score = forcedPlayer->getLastScore();
+    if (forced != nullptr && forced->x == 4 && forced->y == 6 && score == -3) {
+        std::cout << "Correct forced move: (4, 6), score -3" << std::endl;
+    } else {
+        std::cout << "Wrong forced move: got ";
+        if (forced == nullptr) {
+            std::cout << "PASS";
+        } else {
+            std::cout << "(" << forced->x << ", " << forced->y << ")";
+        }
+        std::cout << ", score " << score << ", expected (4, 6), score -3" << std::endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,81 @@
+#include <cstring>
+#include <iostream>
+#include "common.hpp"
+#include "board.hpp"
+#include "positionindex.hpp"
+
+// Moves the square at (x, y) to its place under symmetry s: bit 0 mirrors
+// left to right, bit 1 top to bottom, and bit 2 swaps x and y.
+static uint64_t transform(uint64_t bits, int s) {
+    uint64_t out = 0;
+    for (int square = 0; square < 64; square++) {
+        if (!(bits >> square & 1)) continue;
+        int x = square % 8, y = square / 8;
+        if (s & 1) x = 7 - x;
+        if (s & 2) y = 7 - y;
+        if (s & 4) {
+            int t = x;
+            x = y;
+            y = t;
+        }
+        out |= 1ULL << (x + 8 * y);
+    }
+    return out;
+}
+
+// Checks that positions equal up to a rotation or reflection share one key.
+int main(int argc, char *argv[]) {
+
+    // A lopsided position after d3 c3 b3 b2, with black to move. None of
+    // its eight forms is the same as another.
+    const int moves[] = { 3 + 8 * 2, 2 + 8 * 2, 1 + 8 * 2, 1 + 8 * 1 };
+    Board board;
+    Side turn = BLACK;
+    for (int square : moves) {
+        Move move(square % 8, square / 8);
+        board.doMove(&move, turn);
+        turn = (turn == BLACK) ? WHITE : BLACK;
+    }
+    uint64_t black = board.getBits(BLACK);
+    uint64_t white = board.getBits(WHITE);
+
+    PositionKey key = canonicalKey(black, white);
+    int same = 0;
+    for (int s = 0; s < 8; s++) {
+        PositionKey other = canonicalKey(transform(black, s), transform(white, s));
+        same += other == key;
+    }
+    if (same == 8) {
+        std::cout << "Correct symmetric forms: 8 of 8 share a key" << std::endl;
+    } else {
+        std::cout << "Wrong symmetric forms: " << same << " of 8 share a key, expected 8" << std::endl;
+    }
+
+    // The same position with colors and side to move swapped, and mirrored,
+    // is the same entry: keyed from the mover's view, with the result
+    // counted for the mover.
+    PositionRecord record;
+    memset(&record, 0, sizeof(record));
+    record.black = black;
+    record.white = white;
+    record.side = BLACK;
+    record.result = 10;
+    PositionRecord swapped = record;
+    swapped.black = transform(white, 5);
+    swapped.white = transform(black, 5);
+    swapped.side = WHITE;
+    swapped.result = -10;
+
+    IndexEntry entry = entryFromRecord(record);
+    IndexEntry swappedEntry = entryFromRecord(swapped);
+    if (entry.key == swappedEntry.key && entry.wins == 1 && swappedEntry.wins == 1
+            && entry.discSum == 10 && swappedEntry.discSum == 10) {
+        std::cout << "Correct swapped colors: one entry, a win by 10" << std::endl;
+    } else {
+        std::cout << "Wrong swapped colors: got wins " << entry.wins << " and "
+                  << swappedEntry.wins << ", disc sums " << entry.discSum << " and "
+                  << swappedEntry.discSum << ", expected one entry, a win by 10" << std::endl;
+    }
+
+    return 0;
+}
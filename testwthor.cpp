@@ -0,0 +1,58 @@
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "common.hpp"
+#include "database.hpp"
+
+// Checks that WTHOR games are replayed into the expected position records,
+// including the passes the file format leaves out.
+int main(int argc, char *argv[]) {
+
+    // After white's 14th move (a4) black has no move, so black passes and
+    // white plays e1. The game is cut off there, 19 discs up for white.
+    const uint8_t passMoves[] = {
+        34, 33, 32, 22, 12, 11, 43, 13, 23, 53, 14, 56, 42, 41, 15
+    };
+    WthorGame game;
+    memset(&game, 0, sizeof(game));
+    memcpy(game.moves, passMoves, sizeof(passMoves));
+
+    std::vector<PositionRecord> records;
+    int added = replayWthorGame(&game, records);
+    bool passOk = added == 16 && records.size() == 16
+        && records[14].side == BLACK && records[14].move == -1
+        && records[15].side == WHITE && records[15].move == 4
+        && records[14].black == records[15].black
+        && records[14].white == records[15].white;
+    for (size_t i = 0; passOk && i < records.size(); i++) {
+        passOk = records[i].result == -19;
+    }
+    if (passOk) {
+        std::cout << "Correct game with a pass: 16 records, result -19" << std::endl;
+    } else {
+        std::cout << "Wrong game with a pass: got " << added << " records";
+        if (added > 0) {
+            std::cout << ", result " << (int) records[0].result;
+        }
+        std::cout << ", expected 16 records, result -19" << std::endl;
+    }
+
+    // Black's f5 is legal but white's a1 is not. The record already added
+    // for f5 has to be taken back, leaving the earlier records as they were.
+    memset(game.moves, 0, sizeof(game.moves));
+    game.moves[0] = 56;
+    game.moves[1] = 11;
+    size_t before = records.size();
+    PositionRecord last = records.back();
+    added = replayWthorGame(&game, records);
+    if (added == -1 && records.size() == before
+            && memcmp(&records.back(), &last, sizeof(last)) == 0) {
+        std::cout << "Correct illegal game: -1, records unchanged" << std::endl;
+    } else {
+        std::cout << "Wrong illegal game: got " << added << " and "
+                  << records.size() << " records, expected -1 and "
+                  << before << " records" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "trace.hpp"
+#include <cstring>
+
+static const char TRACE_MAGIC[8] = { 'Q', 'W', 'T', 'R', 'A', 'C', 'E', '6' };
+// Positions are only meaningful to a build for the same board size
+static const int32_t TRACE_BOARD_SIZE = BOARD_SIZE;
+
+TraceWriter::TraceWriter() {
+    file = nullptr;
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+/*
+ * Creates (or truncates) the trace file and writes its header.
+ */
+bool TraceWriter::open(const char *path) {
+    close();
+    file = fopen(path, "wb");
+    if (file == nullptr) return false;
+    if (fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, file) != 1
+            || fwrite(&TRACE_BOARD_SIZE, sizeof(TRACE_BOARD_SIZE), 1, file) != 1) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TraceWriter::write(const TraceMove &move) {
+    if (file == nullptr) return false;
+    uint32_t aborts = move.aborts.size();
+    uint32_t checkpoints = move.checkpoints.size();
+    bool ok = fwrite(&move.black, sizeof(move.black), 1, file) == 1
+        && fwrite(&move.white, sizeof(move.white), 1, file) == 1
+        && fwrite(&move.side, sizeof(move.side), 1, file) == 1
+        && fwrite(&move.msLeft, sizeof(move.msLeft), 1, file) == 1
+        && fwrite(&move.maxDepth, sizeof(move.maxDepth), 1, file) == 1
+        && fwrite(&move.endgameEmpties, sizeof(move.endgameEmpties), 1, file) == 1
+        && fwrite(&move.iidDepth, sizeof(move.iidDepth), 1, file) == 1
+        && fwrite(&move.iidReduction, sizeof(move.iidReduction), 1, file) == 1
+        && fwrite(&move.discEval, sizeof(move.discEval), 1, file) == 1
+        && fwrite(&move.leafEval, sizeof(move.leafEval), 1, file) == 1
+        && fwrite(&move.orderEval, sizeof(move.orderEval), 1, file) == 1
+        && fwrite(&move.ttEntries, sizeof(move.ttEntries), 1, file) == 1
+        && fwrite(&move.endgameEntries, sizeof(move.endgameEntries), 1, file) == 1
+        && fwrite(&move.iterations, sizeof(move.iterations), 1, file) == 1
+        && fwrite(&move.nodes, sizeof(move.nodes), 1, file) == 1
+        && fwrite(&move.move, sizeof(move.move), 1, file) == 1
+        && fwrite(&aborts, sizeof(aborts), 1, file) == 1
+        && fwrite(move.aborts.data(), sizeof(uint64_t), aborts, file) == aborts
+        && fwrite(&checkpoints, sizeof(checkpoints), 1, file) == 1;
+    for (uint32_t i = 0; ok && i < checkpoints; i++) {
+        const TraceCheckpoint &c = move.checkpoints[i];
+        ok = fwrite(&c.depth, sizeof(c.depth), 1, file) == 1
+            && fwrite(&c.score, sizeof(c.score), 1, file) == 1
+            && fwrite(&c.move, sizeof(c.move), 1, file) == 1
+            && fwrite(&c.nodes, sizeof(c.nodes), 1, file) == 1;
+    }
+    return ok && fflush(file) == 0;
+}
+
+void TraceWriter::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
+
+TraceReader::TraceReader() {
+    file = nullptr;
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+/*
+ * Opens a trace file and checks its header, which must be for this build's
+ * board size.
+ */
+bool TraceReader::open(const char *path) {
+    close();
+    file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    char magic[sizeof(TRACE_MAGIC)];
+    int32_t size;
+    if (fread(magic, sizeof(magic), 1, file) != 1
+            || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+            || fread(&size, sizeof(size), 1, file) != 1 || size != TRACE_BOARD_SIZE) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Reads the next move. Returns false at the end of the file or if the last
+ * record was cut short.
+ */
+bool TraceReader::next(TraceMove &move) {
+    if (file == nullptr) return false;
+    uint32_t aborts, checkpoints;
+    bool ok = fread(&move.black, sizeof(move.black), 1, file) == 1
+        && fread(&move.white, sizeof(move.white), 1, file) == 1
+        && fread(&move.side, sizeof(move.side), 1, file) == 1
+        && fread(&move.msLeft, sizeof(move.msLeft), 1, file) == 1
+        && fread(&move.maxDepth, sizeof(move.maxDepth), 1, file) == 1
+        && fread(&move.endgameEmpties, sizeof(move.endgameEmpties), 1, file) == 1
+        && fread(&move.iidDepth, sizeof(move.iidDepth), 1, file) == 1
+        && fread(&move.iidReduction, sizeof(move.iidReduction), 1, file) == 1
+        && fread(&move.discEval, sizeof(move.discEval), 1, file) == 1
+        && fread(&move.leafEval, sizeof(move.leafEval), 1, file) == 1
+        && fread(&move.orderEval, sizeof(move.orderEval), 1, file) == 1
+        && fread(&move.ttEntries, sizeof(move.ttEntries), 1, file) == 1
+        && fread(&move.endgameEntries, sizeof(move.endgameEntries), 1, file) == 1
+        && fread(&move.iterations, sizeof(move.iterations), 1, file) == 1
+        && fread(&move.nodes, sizeof(move.nodes), 1, file) == 1
+        && fread(&move.move, sizeof(move.move), 1, file) == 1
+        && fread(&aborts, sizeof(aborts), 1, file) == 1
+        && aborts <= 64;
+    if (!ok) return false;
+    move.aborts.resize(aborts);
+    ok = fread(move.aborts.data(), sizeof(uint64_t), aborts, file) == aborts
+        && fread(&checkpoints, sizeof(checkpoints), 1, file) == 1
+        && checkpoints <= 256;
+    if (!ok) return false;
+    move.checkpoints.resize(checkpoints);
+    for (uint32_t i = 0; ok && i < checkpoints; i++) {
+        TraceCheckpoint &c = move.checkpoints[i];
+        ok = fread(&c.depth, sizeof(c.depth), 1, file) == 1
+            && fread(&c.score, sizeof(c.score), 1, file) == 1
+            && fread(&c.move, sizeof(c.move), 1, file) == 1
+            && fread(&c.nodes, sizeof(c.nodes), 1, file) == 1;
+    }
+    return ok;
+}
+
+void TraceReader::close() {
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+}
@@ -0,0 +1,85 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "board.hpp"
+
+/*
+ * A point the iterative deepening driver reached: an iteration that
+ * completed, or an exact endgame solve (depth is then the number of empties).
+ */
+struct TraceCheckpoint {
+    int32_t depth;
+    int32_t score;
+    int32_t move;           // best move, x + BOARD_SIZE*y, or -1 for a pass
+    uint64_t nodes;         // nodes searched this move when it completed
+};
+
+/*
+ * Everything needed to rerun one doMove search exactly: the position, clock
+ * and settings it started from, the node counts at which the clock stopped a
+ * search, and how many iterations were started. The search itself uses no
+ * randomness, so there are no seeds to record. A transposition table carries
+ * results over from the player's earlier moves; those are rebuilt by
+ * replaying the earlier moves of the trace first into a table of the same
+ * size. The same goes for the endgame table.
+ */
+struct TraceMove {
+    Board::Bits black, white;
+    int32_t side;
+    int32_t msLeft;
+    int32_t maxDepth;
+    int32_t endgameEmpties;
+    int32_t iidDepth;
+    int32_t iidReduction;
+    int32_t discEval;
+    int32_t leafEval;       // EvalKind of the leaf and ordering evaluators
+    int32_t orderEval;
+    uint64_t ttEntries;     // size of the player's own table, 0 if it had none
+    uint64_t endgameEntries;    // likewise for its endgame table
+    int32_t iterations;
+    std::vector<uint64_t> aborts;
+    std::vector<TraceCheckpoint> checkpoints;
+    uint64_t nodes;
+    int32_t move;
+};
+
+/*
+ * Writes search traces to a binary file: a header with the board size, then
+ * one variable length record per move in native byte order. Each move is flushed as soon as it is
+ * written, so a crash mid-game keeps every earlier move.
+ */
+class TraceWriter {
+
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(const char *path);
+    bool write(const TraceMove &move);
+    void close();
+
+private:
+    FILE *file;
+};
+
+/*
+ * Reads back what TraceWriter wrote.
+ */
+class TraceReader {
+
+public:
+    TraceReader();
+    ~TraceReader();
+
+    bool open(const char *path);
+    bool next(TraceMove &move);
+    void close();
+
+private:
+    FILE *file;
+};
+
+#endif
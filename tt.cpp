@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <sys/mman.h>
+#include "tt.hpp"
+#include "memory.hpp"
+
+// Fewest entries worth having a table for
+#define TT_MIN_ENTRIES (1024)
+
+/*
+ * Allocates the largest power of two number of entries that fits in the given
+ * number of bytes and in the memory budget, reserved under component, halving
+ * it for as long as the allocation fails. Returns the entries, all zero, and
+ * sets count to how many there are; with none it returns nullptr.
+ *
+ * An all-zero entry is an empty one in both tables, so the entries are mapped
+ * straight from the system, which hands out zeroed pages as they are first
+ * written. Nothing is touched until it is used: starting up does not pay for
+ * the whole table, and a fork server's children do not copy pages they
+ * inherited. Huge pages make those first writes a few hundred faults for a
+ * large table instead of tens of thousands.
+ */
+template <typename T>
+static T *allocateTable(size_t bytes, const char *component, size_t *count) {
+    size_t entries = 1;
+    while (entries * 2 * sizeof(T) <= bytes) entries *= 2;
+    size_t granted = MemoryBudget::process().reserve(component, entries * sizeof(T),
+        TT_MIN_ENTRIES * sizeof(T));
+    while (entries * sizeof(T) > granted) entries /= 2;
+
+    T *table = nullptr;
+    while (entries >= TT_MIN_ENTRIES && table == nullptr) {
+        void *pages = mmap(nullptr, entries * sizeof(T), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages == MAP_FAILED) {
+            entries /= 2;
+        } else {
+            madvise(pages, entries * sizeof(T), MADV_HUGEPAGE);
+            table = (T *) pages;
+        }
+    }
+    if (table == nullptr) entries = 0;
+    MemoryBudget::process().release(component, granted - entries * sizeof(T));
+    *count = entries;
+    return table;
+}
+
+/*
+ * Folds a bitboard into one word for hashing; a one-word board is its own.
+ */
+static inline uint64_t hashWord(uint64_t bits) {
+    return bits;
+}
+
+static inline uint64_t hashWord(uint128_t bits) {
+    return (uint64_t) bits ^ (uint64_t) (bits >> 64) * 0xFF51AFD7ED558CCDULL;
+}
+
+static uint64_t hashPosition(Board::Bits blackBits, Board::Bits whiteBits, Side side) {
+    uint64_t black = hashWord(blackBits);
+    uint64_t white = hashWord(whiteBits);
+    uint64_t h = black * 0x9E3779B97F4A7C15ULL;
+    h ^= (white + side) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return h;
+}
+
+TranspositionTable::TranspositionTable(size_t bytes) {
+    table = allocateTable<TTEntry>(bytes, "tt", &entries);
+    mask = entries == 0 ? 0 : entries - 1;
+}
+
+TranspositionTable::~TranspositionTable() {
+    MemoryBudget::process().release("tt", entries * sizeof(TTEntry));
+    if (table != nullptr) munmap(table, entries * sizeof(TTEntry));
+}
+
+/*
+ * Forgets every stored result.
+ */
+void TranspositionTable::clear() {
+    TTEntry empty = {};
+    for (int i = 0; i < LOCKS; i++) {
+        locks[i].lock();
+    }
+    std::fill(table, table + entries, empty);
+    for (int i = 0; i < LOCKS; i++) {
+        locks[i].unlock();
+    }
+}
+
+size_t TranspositionTable::index(Board::Bits black, Board::Bits white, Side side) {
+    return hashPosition(black, white, side) & mask;
+}
+
+/*
+ * Copies the stored result for the position into entry. Returns false if the
+ * position is not in the table.
+ */
+bool TranspositionTable::probe(Board *board, Side side, TTEntry *entry) {
+    if (entries == 0) return false;
+    Board::Bits black = board->getBits(BLACK);
+    Board::Bits white = board->getBits(WHITE);
+    size_t i = index(black, white, side);
+    std::lock_guard<std::mutex> guard(locks[i % LOCKS]);
+    const TTEntry &e = table[i];
+    if (e.bound == BOUND_NONE || e.black != black || e.white != white || e.side != side) {
+        return false;
+    }
+    *entry = e;
+    return true;
+}
+
+void TranspositionTable::store(Board *board, Side side, int depth, int score, Bound bound,
+        int move) {
+    if (entries == 0) return;
+    Board::Bits black = board->getBits(BLACK);
+    Board::Bits white = board->getBits(WHITE);
+    size_t i = index(black, white, side);
+    std::lock_guard<std::mutex> guard(locks[i % LOCKS]);
+    TTEntry &e = table[i];
+    bool samePosition = e.bound != BOUND_NONE && e.black == black && e.white == white
+        && e.side == side;
+    if (samePosition && e.depth > depth) return;
+    //keep the old best move if this search did not find one
+    if (move < 0 && samePosition) move = e.move;
+    TTEntry entry = { black, white, score, (int8_t) depth, (uint8_t) bound, (int8_t) move,
+        (uint8_t) side };
+    e = entry;
+}
+
+EndgameTable::EndgameTable(size_t bytes) {
+    table = allocateTable<EndgameEntry>(bytes, "endgame-tt", &entries);
+    //positions hash to the first slot of a pair, so the mask leaves out bit 0
+    mask = entries == 0 ? 0 : entries - 2;
+}
+
+EndgameTable::~EndgameTable() {
+    MemoryBudget::process().release("endgame-tt", entries * sizeof(EndgameEntry));
+    if (table != nullptr) munmap(table, entries * sizeof(EndgameEntry));
+}
+
+/*
+ * Forgets every stored result. An empty slot holds no discs, which no
+ * position does, and no empties, so anything replaces it.
+ */
+void EndgameTable::clear() {
+    EndgameEntry empty = {};
+    for (int i = 0; i < LOCKS; i++) {
+        locks[i].lock();
+    }
+    std::fill(table, table + entries, empty);
+    for (int i = 0; i < LOCKS; i++) {
+        locks[i].unlock();
+    }
+}
+
+/*
+ * Copies the stored bounds for the position into entry. Returns false if the
+ * position is not in the table.
+ */
+bool EndgameTable::probe(Board *board, Side side, EndgameEntry *entry) {
+    if (entries == 0) return false;
+    Board::Bits black = board->getBits(BLACK);
+    Board::Bits white = board->getBits(WHITE);
+    size_t i = hashPosition(black, white, side) & mask;
+    std::lock_guard<std::mutex> guard(locks[(i >> 1) % LOCKS]);
+    for (size_t slot = i; slot < i + 2; slot++) {
+        const EndgameEntry &e = table[slot];
+        if (e.black == black && e.white == white && e.side == side) {
+            *entry = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Records bounds on the final disc difference of a position with the given
+ * number of empties. If the position is already stored the bounds are
+ * combined; otherwise it goes in the first slot of its pair if it has at least
+ * as many empties as what is there, which moves to the second slot, and in the
+ * second slot if not.
+ */
+void EndgameTable::store(Board *board, Side side, int empties, int lower, int upper, int move) {
+    if (entries == 0) return;
+    Board::Bits black = board->getBits(BLACK);
+    Board::Bits white = board->getBits(WHITE);
+    size_t i = hashPosition(black, white, side) & mask;
+    std::lock_guard<std::mutex> guard(locks[(i >> 1) % LOCKS]);
+    EndgameEntry entry = { black, white, (int8_t) lower, (int8_t) upper, (int8_t) move,
+        (uint8_t) empties, (uint8_t) side };
+    for (size_t slot = i; slot < i + 2; slot++) {
+        EndgameEntry &e = table[slot];
+        if (e.black == black && e.white == white && e.side == side) {
+            entry.lower = std::max(entry.lower, e.lower);
+            entry.upper = std::min(entry.upper, e.upper);
+            //keep the old best move if this search did not find one
+            if (move < 0) entry.move = e.move;
+            e = entry;
+            return;
+        }
+    }
+    if (empties >= table[i].empties) {
+        table[i + 1] = table[i];
+        table[i] = entry;
+    } else {
+        table[i + 1] = entry;
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef __TT_H__
+#define __TT_H__
+
+#include <cstdint>
+#include <mutex>
+#include "common.hpp"
+#include "board.hpp"
+
+// Size of an endgame table: small enough to stay in the L2 or L3 cache
+#define ENDGAME_TT_BYTES (2 << 20)
+
+// What a stored score says about the true score of the position
+enum Bound {
+    BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT
+};
+
+/*
+ * One stored search result. The full position is kept rather than a hash
+ * signature, so a collision can never return another position's score.
+ */
+struct TTEntry {
+    Board::Bits black, white;
+    int32_t score;
+    int8_t depth;
+    uint8_t bound;
+    int8_t move;            // best move, x + BOARD_SIZE*y, or -1 if none is known
+    uint8_t side;
+};
+
+/*
+ * Transposition table for the heuristic search, safe to share between any
+ * number of players on different threads. Slots are guarded by striped
+ * locks; a new result replaces whatever is in its slot unless that is the
+ * same position searched deeper. Scores depend on the evaluation, so players
+ * sharing a table must use the same one. The table's memory comes out of the
+ * process memory budget; if the budget or the allocator cannot give it the
+ * size asked for it makes do with less, and with no memory at all it simply
+ * never finds anything.
+ */
+class TranspositionTable {
+
+public:
+    TranspositionTable(size_t bytes);
+    ~TranspositionTable();
+
+    bool probe(Board *board, Side side, TTEntry *entry);
+    void store(Board *board, Side side, int depth, int score, Bound bound, int move);
+    void clear();
+    size_t size() { return entries; }
+
+private:
+    static const int LOCKS = 256;
+    TTEntry *table;
+    size_t entries;
+    size_t mask;
+    std::mutex locks[LOCKS];
+
+    size_t index(Board::Bits black, Board::Bits white, Side side);
+};
+
+/*
+ * One solved position: bounds on the final disc difference for the side to
+ * move with perfect play, equal when the score is exact.
+ */
+struct EndgameEntry {
+    Board::Bits black, white;
+    int8_t lower, upper;
+    int8_t move;            // best move, x + BOARD_SIZE*y, or -1 if none is known
+    uint8_t empties;
+    uint8_t side;
+};
+
+/*
+ * Transposition table for the exact endgame solver, kept apart from the
+ * heuristic search's table so that the many small subtrees of a solve do not
+ * push out the midgame results, and small enough to stay in cache. Its scores
+ * are disc differences that hold whatever evaluation the players use. Slots
+ * come in pairs: one keeps the position with the most empties, which saves
+ * the most work when found again, and the other always takes the newest one.
+ * Shared and budgeted like TranspositionTable.
+ */
+class EndgameTable {
+
+public:
+    EndgameTable(size_t bytes);
+    ~EndgameTable();
+
+    bool probe(Board *board, Side side, EndgameEntry *entry);
+    void store(Board *board, Side side, int empties, int lower, int upper, int move);
+    void clear();
+    size_t size() { return entries; }
+
+private:
+    static const int LOCKS = 64;
+    EndgameEntry *table;
+    size_t entries;
+    size_t mask;
+    std::mutex locks[LOCKS];
+};
+
+#endif
@@ -1,19 +1,121 @@
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "player.hpp"
+#include "game.hpp"
+#include "nboard.hpp"
 using namespace std;
 
-int main(int argc, char *argv[]) {
-    // Read in side the player is on.
-    if (argc != 2)  {
-        cerr << "usage: " << argv[0] << " side" << endl;
-        exit(-1);
+// Longest argument list a fork server accepts from one client
+#define MAX_HANDOFF_BYTES (1024)
+// The resource limits a client passes on to the game it hands off, so that
+// the game runs under the limits WrapperPlayer put on the client (ulimit -v
+// and -m) rather than the server's
+static const int HANDOFF_LIMITS[] = { RLIMIT_AS, RLIMIT_RSS };
+#define HANDOFF_LIMIT_COUNT (sizeof(HANDOFF_LIMITS) / sizeof(HANDOFF_LIMITS[0]))
+
+/*
+ * What the engine sets up before it knows which game it is playing. A fork
+ * server makes this once, and every game it forks starts from it.
+ */
+struct EngineState {
+    Player *player;
+    TranspositionTable *table;
+    EndgameTable *endgameTable;
+};
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " side [opening]" << endl;
+    cerr << "       " << name << " --fork-server socket" << endl;
+    cerr << "       " << name << " --nboard" << endl;
+    exit(-1);
+}
+
+/*
+ * Sets the memory budget and allocates the tables and the player, which
+ * starts out playing black from the initial position.
+ */
+static EngineState startEngine() {
+    // QWERTY_MEMORY_MB=<n> is the most memory the engine may use, by default
+    // the limit WrapperPlayer runs it under. Going over that kills the game,
+    // so the engine keeps its own allocations below it, with some headroom.
+    size_t memoryMB = DEFAULT_MEMORY_BUDGET_MB;
+    const char *memory = getenv("QWERTY_MEMORY_MB");
+    if (memory != nullptr && strtoul(memory, nullptr, 10) > 0) {
+        memoryMB = strtoul(memory, nullptr, 10);
     }
+    MemoryBudget &budget = MemoryBudget::process();
+    budget.setLimit(memoryMB > MEMORY_HEADROOM_MB ? (memoryMB - MEMORY_HEADROOM_MB) << 20 : 0);
+
+    EngineState engine;
+    engine.player = new Player(BLACK);
+    engine.endgameTable = new EndgameTable(ENDGAME_TT_BYTES);
+    engine.table = new TranspositionTable(budget.getAvailable() / TT_BUDGET_SHARE);
+    engine.player->setTranspositionTable(engine.table);
+    engine.player->setEndgameTable(engine.endgameTable);
+    return engine;
+}
+
+/*
+ * Plays one game over stdin and stdout, the way WrapperPlayer runs it, with a
+ * player fresh from startEngine().
+ */
+static int playGame(EngineState &engine, int argc, char *argv[]) {
+    // Read in side the player is on, and optionally an opening (e.g. f5d6c3)
+    // the game starts from instead of the initial position.
+    if (argc != 2 && argc != 3) usage(argv[0]);
     Side side = (!strcmp(argv[1], "Black")) ? BLACK : WHITE;
+    vector<int> opening;
+    if (argc == 3 && !parseOpening(argv[2], opening)) {
+        cerr << "bad opening: " << argv[2] << endl;
+        exit(-1);
+    }
 
-    // Initialize player.
-    Player *player = new Player(side);
+    Player *player = engine.player;
+    player->setSide(side);
+    if (!opening.empty()) {
+        Board *board = new Board();
+        applyOpening(board, opening);
+        player->setBoard(board);
+    }
+
+    // QWERTY_TELEMETRY=stderr writes a JSON line per move to stderr, which
+    // WrapperPlayer forwards; any other value is a file to append them to.
+    ofstream telemetryFile;
+    const char *telemetry = getenv("QWERTY_TELEMETRY");
+    if (telemetry != nullptr && !strcmp(telemetry, "stderr")) {
+        player->setTelemetry(&cerr);
+    } else if (telemetry != nullptr && *telemetry != '\0') {
+        telemetryFile.open(telemetry, ios::app);
+        if (telemetryFile) player->setTelemetry(&telemetryFile);
+    }
+
+    // QWERTY_PERF=1 adds hardware counters per search phase to the telemetry.
+    const char *perf = getenv("QWERTY_PERF");
+    if (perf != nullptr && !strcmp(perf, "1")) {
+        player->setPerfCounters(true);
+    }
+
+    // QWERTY_TRACE=<file> records every search so that it can be rerun
+    // exactly with the replay tool.
+    TraceWriter trace;
+    const char *tracePath = getenv("QWERTY_TRACE");
+    if (tracePath != nullptr && *tracePath != '\0') {
+        if (trace.open(tracePath)) {
+            player->setTrace(&trace);
+        } else {
+            cerr << "cannot write trace " << tracePath << endl;
+        }
+    }
 
     // Tell java wrapper that we are done initializing.
     cout << "Init done" << endl;
@@ -43,5 +145,223 @@ int main(int argc, char *argv[]) {
         if (playersMove != nullptr) delete playersMove;
     }
 
+    delete player;
+    delete engine.table;
+    delete engine.endgameTable;
     return 0;
 }
+
+static bool socketAddress(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return false;
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+/*
+ * Asks the fork server at path to play this game. Our arguments, resource
+ * limits, and stdin, stdout and stderr are passed to it; the process it forks
+ * talks to the game directly, and the server reports how that process ended
+ * once it has, so this process lives exactly as long as the game and sets
+ * status to the game's exit status. Returns false, having touched nothing, if
+ * no server took the game.
+ */
+static bool handOff(const char *path, int argc, char *argv[], int *status) {
+    struct sockaddr_un addr;
+    if (!socketAddress(path, &addr)) return false;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // The limits and the arguments go as one message, each argument ended by
+    // a NUL, with the three descriptors attached.
+    struct rlimit limits[HANDOFF_LIMIT_COUNT];
+    for (size_t i = 0; i < HANDOFF_LIMIT_COUNT; i++) {
+        if (getrlimit(HANDOFF_LIMITS[i], &limits[i]) < 0) {
+            close(fd);
+            return false;
+        }
+    }
+    string args;
+    for (int i = 1; i < argc; i++) {
+        args.append(argv[i]);
+        args.push_back('\0');
+    }
+    if (args.size() > MAX_HANDOFF_BYTES) {
+        close(fd);
+        return false;
+    }
+    int fds[3] = { 0, 1, 2 };
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    struct iovec iov[2] = {
+        { limits, sizeof(limits) },
+        { (void *) args.data(), args.size() }
+    };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        close(fd);
+        return false;
+    }
+
+    // The server answers once it has forked the game's process; after that
+    // the game is no longer ours to play even if something goes wrong.
+    char answer;
+    ssize_t got;
+    while ((got = recv(fd, &answer, 1, 0)) < 0 && errno == EINTR) {}
+    if (got != 1) {
+        close(fd);
+        return false;
+    }
+    // Then it sends the game's exit status when the game ends. A connection
+    // that closes without one means the server lost track of the game.
+    int32_t gameStatus;
+    while ((got = recv(fd, &gameStatus, sizeof(gameStatus), 0)) < 0 && errno == EINTR) {}
+    *status = got == sizeof(gameStatus) ? gameStatus : EXIT_FAILURE;
+    close(fd);
+    return true;
+}
+
+/*
+ * Runs as a fork server: everything the engine sets up at startup is done
+ * once here, and every game handed over by handOff() is played by a process
+ * forked from this one, which shares those pages copy-on-write, next to
+ * another that waits for it and sends its exit status back. The
+ * server never plays, so the tables a child starts with are still empty and
+ * there is nothing to reset. Only returns if the socket cannot be set up.
+ */
+static int forkServer(const char *path) {
+    struct sockaddr_un addr;
+    if (!socketAddress(path, &addr)) {
+        cerr << "fork server: socket path too long: " << path << endl;
+        return -1;
+    }
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+    int listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0
+            || listen(listenFd, 128) < 0) {
+        cerr << "fork server: cannot listen on " << path << ": " << strerror(errno) << endl;
+        return -1;
+    }
+    // Children are never waited for; each game's own waits for it.
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    EngineState engine = startEngine();
+    cerr << "fork server: listening on " << path << endl;
+
+    while (true) {
+        int conn = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0) continue;
+
+        struct rlimit limits[HANDOFF_LIMIT_COUNT];
+        char args[MAX_HANDOFF_BYTES + 1];
+        int fds[3] = { -1, -1, -1 };
+        char control[CMSG_SPACE(sizeof(fds))];
+        struct iovec iov[2] = {
+            { limits, sizeof(limits) },
+            { args, MAX_HANDOFF_BYTES }
+        };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t got = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+        struct cmsghdr *cmsg = got > 0 ? CMSG_FIRSTHDR(&msg) : nullptr;
+        if (cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+                && cmsg->cmsg_len == CMSG_LEN(sizeof(fds))) {
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        }
+        if (fds[0] < 0 || got < (ssize_t) sizeof(limits)
+                || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+            for (int i = 0; i < 3; i++) {
+                if (fds[i] >= 0) close(fds[i]);
+            }
+            close(conn);
+            continue;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            // This process holds the connection and waits for the game,
+            // which runs in a process of its own under the client's limits.
+            close(listenFd);
+            signal(SIGCHLD, SIG_DFL);
+            pid_t game = fork();
+            if (game == 0) {
+                close(conn);
+                for (size_t i = 0; i < HANDOFF_LIMIT_COUNT; i++) {
+                    setrlimit(HANDOFF_LIMITS[i], &limits[i]);
+                }
+                for (int i = 0; i < 3; i++) {
+                    dup2(fds[i], i);
+                    close(fds[i]);
+                }
+                size_t length = got - sizeof(limits);
+                vector<char*> childArgv(1, (char *) "qwerty");
+                args[length] = '\0';
+                for (size_t i = 0; i < length; i += strlen(args + i) + 1) {
+                    childArgv.push_back(args + i);
+                }
+                childArgv.push_back(nullptr);
+                exit(playGame(engine, childArgv.size() - 1, childArgv.data()));
+            }
+            for (int i = 0; i < 3; i++) {
+                close(fds[i]);
+            }
+            if (game < 0) _exit(EXIT_FAILURE);
+            char ok = 1;
+            send(conn, &ok, 1, MSG_NOSIGNAL);
+
+            // A game killed by a signal reports it the way a shell would.
+            int waitStatus;
+            while (waitpid(game, &waitStatus, 0) < 0 && errno == EINTR) {}
+            int32_t status = WIFEXITED(waitStatus) ? WEXITSTATUS(waitStatus)
+                : 128 + WTERMSIG(waitStatus);
+            send(conn, &status, sizeof(status), MSG_NOSIGNAL);
+            _exit(0);
+        }
+        for (int i = 0; i < 3; i++) {
+            close(fds[i]);
+        }
+        close(conn);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && !strcmp(argv[1], "--fork-server")) {
+        return forkServer(argv[2]);
+    }
+    if (argc == 2 && !strcmp(argv[1], "--nboard")) {
+        NBoardSession session(cin, cout);
+        return session.run();
+    }
+
+    // QWERTY_FORKSERVER=<socket> hands the game to a fork server started
+    // with "qwerty --fork-server <socket>" if one is listening there, and
+    // plays it in this process otherwise.
+    const char *server = getenv("QWERTY_FORKSERVER");
+    int status;
+    if (server != nullptr && *server != '\0' && handOff(server, argc, argv, &status)) {
+        return status;
+    }
+    if (argc != 2 && argc != 3) usage(argv[0]);
+    EngineState engine = startEngine();
+    return playGame(engine, argc, argv);
+}
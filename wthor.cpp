@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "database.hpp"
+#include "record.hpp"
+using namespace std;
+
+/*
+ * Converts WTHOR game databases (.wtb) into position records, one per move
+ * played, labeled with the game's final disc difference. The files are
+ * mapped into memory and split into chunks of games that worker threads
+ * replay in parallel, so that a large archive is limited by the disk rather
+ * than by replaying. Each chunk's records are appended in one write, so
+ * records from a game are contiguous but chunks come out in whatever order
+ * they finish.
+ */
+
+/*
+ * A run of consecutive games in one file.
+ */
+struct WthorChunk {
+    WthorFile *file;
+    size_t first, count;
+};
+
+static vector<WthorChunk> chunks;
+static atomic<size_t> nextChunk(0);
+static atomic<long long> gamesDone(0);
+static atomic<long long> badGames(0);
+static atomic<long long> positionsDone(0);
+static RecordWriter writer;
+static bool writing = false;
+static atomic<bool> writeFailed(false);
+
+static void usage(const char *name) {
+    cerr << "usage: " << name << " [-j threads] [-c gamesPerChunk] [-o output] files..." << endl;
+    cerr << "without -o the games are only replayed and counted" << endl;
+    exit(-1);
+}
+
+/*
+ * Worker thread body; replays chunks until there are none left.
+ */
+static void worker() {
+    vector<PositionRecord> records;
+    size_t c;
+    while ((c = nextChunk++) < chunks.size()) {
+        WthorChunk &chunk = chunks[c];
+        records.clear();
+        long long bad = 0;
+        for (size_t g = chunk.first; g < chunk.first + chunk.count; g++) {
+            if (replayWthorGame(chunk.file->game(g), records) < 0) bad++;
+        }
+        if (writing && !writer.write(records.data(), records.size())) writeFailed = true;
+        gamesDone += chunk.count - bad;
+        badGames += bad;
+        positionsDone += records.size();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int threads = thread::hardware_concurrency();
+    size_t chunkGames = 4096;
+    const char *output = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:c:o:")) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'c': chunkGames = strtoul(optarg, nullptr, 10); break;
+            case 'o': output = optarg; break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind == argc || chunkGames < 1) usage(argv[0]);
+    if (threads < 1) threads = 1;
+
+    vector<WthorFile*> files;
+    double megabytes = 0.0;
+    for (int i = optind; i < argc; i++) {
+        WthorFile *file = new WthorFile();
+        if (!file->open(argv[i])) {
+            cerr << "wthor: cannot read " << argv[i] << " as a WTHOR game database" << endl;
+            exit(-1);
+        }
+        files.push_back(file);
+        megabytes += (WTHOR_HEADER_BYTES + file->gameCount() * WTHOR_GAME_BYTES) / 1048576.0;
+        for (size_t first = 0; first < file->gameCount(); first += chunkGames) {
+            WthorChunk chunk = { file, first, min(chunkGames, file->gameCount() - first) };
+            chunks.push_back(chunk);
+        }
+    }
+    if (output != nullptr) {
+        if (!writer.open(output, 0)) {
+            cerr << "wthor: cannot write " << output << endl;
+            exit(-1);
+        }
+        writing = true;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.push_back(thread(worker));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+    writer.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << gamesDone << " games (" << badGames << " with illegal moves skipped), "
+         << positionsDone << " positions from " << files.size() << " files in "
+         << seconds << " s: " << (long long) (gamesDone / max(seconds, 1e-9)) << " games/s, "
+         << megabytes / max(seconds, 1e-9) << " MB/s" << endl;
+    for (size_t i = 0; i < files.size(); i++) {
+        delete files[i];
+    }
+    if (writeFailed) {
+        cerr << "wthor: write to " << output << " failed" << endl;
+        return 1;
+    }
+    return 0;
+}